@@ -0,0 +1,102 @@
+/**********************************************************************************
+*  MIT License                                                                    *
+*                                                                                 *
+*  Copyright (c) 2022 Vahan Aghajanyan <vahancho@gmail.com>                       *
+*                                                                                 *
+*  Permission is hereby granted, free of charge, to any person obtaining a copy   *
+*  of this software and associated documentation files (the "Software"), to deal  *
+*  in the Software without restriction, including without limitation the rights   *
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+*  copies of the Software, and to permit persons to whom the Software is          *
+*  furnished to do so, subject to the following conditions:                       *
+*                                                                                 *
+*  The above copyright notice and this permission notice shall be included in all *
+*  copies or substantial portions of the Software.                                *
+*                                                                                 *
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+*  SOFTWARE.                                                                      *
+***********************************************************************************/
+
+#include <cassert>
+#include <cstddef>
+
+#include "bitmask.h"
+
+namespace nkar
+{
+
+BitMask::BitMask()
+  :
+    m_width(0),
+    m_height(0),
+    m_wordsPerRow(0)
+{}
+
+BitMask::BitMask(int width, int height)
+  :
+    m_width(width),
+    m_height(height),
+    m_wordsPerRow((width + 63) / 64)
+{
+  m_words.assign((size_t)m_wordsPerRow * height, 0);
+}
+
+int BitMask::width() const
+{
+  return m_width;
+}
+
+int BitMask::height() const
+{
+  return m_height;
+}
+
+int BitMask::wordsPerRow() const
+{
+  return m_wordsPerRow;
+}
+
+bool BitMask::isNull() const
+{
+  return m_words.empty();
+}
+
+const uint64_t *BitMask::row(int row) const
+{
+  assert(row >= 0 && row < m_height);
+  return m_words.data() + (size_t)row * m_wordsPerRow;
+}
+
+uint64_t *BitMask::row(int row)
+{
+  assert(row >= 0 && row < m_height);
+  return m_words.data() + (size_t)row * m_wordsPerRow;
+}
+
+bool BitMask::test(int x, int y) const
+{
+  assert(x >= 0 && x < m_width);
+  return (row(y)[x / 64] >> (x % 64)) & 1;
+}
+
+void BitMask::set(int x, int y)
+{
+  assert(x >= 0 && x < m_width);
+  row(y)[x / 64] |= uint64_t(1) << (x % 64);
+}
+
+size_t BitMask::count() const
+{
+  size_t count = 0;
+  for (auto word : m_words) {
+    count += bitCount(word);
+  }
+  return count;
+}
+
+}
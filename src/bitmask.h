@@ -0,0 +1,176 @@
+/**********************************************************************************
+*  MIT License                                                                    *
+*                                                                                 *
+*  Copyright (c) 2022 Vahan Aghajanyan <vahancho@gmail.com>                       *
+*                                                                                 *
+*  Permission is hereby granted, free of charge, to any person obtaining a copy   *
+*  of this software and associated documentation files (the "Software"), to deal  *
+*  in the Software without restriction, including without limitation the rights   *
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+*  copies of the Software, and to permit persons to whom the Software is          *
+*  furnished to do so, subject to the following conditions:                       *
+*                                                                                 *
+*  The above copyright notice and this permission notice shall be included in all *
+*  copies or substantial portions of the Software.                                *
+*                                                                                 *
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+*  SOFTWARE.                                                                      *
+***********************************************************************************/
+
+#ifndef _BITMASK_H_
+#define _BITMASK_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "export.h"
+
+#if defined(_MSC_VER)
+  #include <intrin.h>
+#endif
+
+namespace nkar
+{
+
+//! Returns the index of the lowest set bit of \p word. The \p word must not be zero.
+inline int lowestBit(uint64_t word)
+{
+#if defined(_MSC_VER)
+  unsigned long idx;
+  if (_BitScanForward(&idx, (unsigned long)word)) {
+    return (int)idx;
+  }
+  _BitScanForward(&idx, (unsigned long)(word >> 32));
+  return (int)idx + 32;
+#else
+  return __builtin_ctzll(word);
+#endif
+}
+
+//! Returns the index of the highest set bit of \p word. The \p word must not be zero.
+inline int highestBit(uint64_t word)
+{
+#if defined(_MSC_VER)
+  unsigned long idx;
+  if (_BitScanReverse(&idx, (unsigned long)(word >> 32))) {
+    return (int)idx + 32;
+  }
+  _BitScanReverse(&idx, (unsigned long)word);
+  return (int)idx;
+#else
+  return 63 - __builtin_clzll(word);
+#endif
+}
+
+//! Returns the number of set bits of \p word.
+inline int bitCount(uint64_t word)
+{
+#if defined(_MSC_VER)
+  // The popcnt instruction is not guaranteed to be available.
+  word = word - ((word >> 1) & 0x5555555555555555ULL);
+  word = (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+  word = (word + (word >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+  return (int)((word * 0x0101010101010101ULL) >> 56);
+#else
+  return __builtin_popcountll(word);
+#endif
+}
+
+//! Implements a two dimensional matrix of bits.
+/*!
+  Bits of each row are packed into 64-bit words: the bit \c x of the row is stored
+  in the word <tt>x / 64</tt> at the position <tt>x % 64</tt>. Each row starts
+  with a new word and the unused bits of the last word are always zero.
+
+  The comparison result provides the pixel difference mask of this type, that
+  can be analyzed word by word:
+
+  \code
+  mask.forEachWord([](int x, int y, uint64_t word) {
+    // The bit i of the word corresponds to the pixel (x + i, y).
+  });
+  \endcode
+*/
+class NKAR_EXPORT BitMask
+{
+public:
+  //! Constructs an empty mask.
+  BitMask();
+
+  //! Constructs a mask of the given dimensions with all bits cleared.
+  BitMask(int width, int height);
+
+  //! Returns the number of bits in each row.
+  int width() const;
+
+  //! Returns the number of rows.
+  int height() const;
+
+  //! Returns the number of 64-bit words in each row.
+  int wordsPerRow() const;
+
+  //! Returns true if the mask has zero dimensions.
+  bool isNull() const;
+
+  //! Returns a pointer to the first word of the given \p row.
+  const uint64_t *row(int row) const;
+
+  //! Returns a pointer to the first word of the given \p row.
+  uint64_t *row(int row);
+
+  //! Returns true if the bit at the given position is set.
+  bool test(int x, int y) const;
+
+  //! Sets the bit at the given position.
+  void set(int x, int y);
+
+  //! Returns the number of set bits.
+  size_t count() const;
+
+  //! Calls the \p function for each word with at least one set bit.
+  /*!
+    The function is called as <tt>function(x, y, word)</tt>, where \c x is the
+    position of the lowest bit of the \c word in the row \c y. The words are
+    visited row by row from left to right.
+  */
+  template <typename Function>
+  void forEachWord(Function function) const
+  {
+    for (int y = 0; y < m_height; ++y) {
+      const uint64_t *words = row(y);
+      for (int w = 0; w < m_wordsPerRow; ++w) {
+        if (words[w]) {
+          function(w * 64, y, words[w]);
+        }
+      }
+    }
+  }
+
+  //! Calls the \p function as <tt>function(x, y)</tt> for each set bit.
+  template <typename Function>
+  void forEachSetBit(Function function) const
+  {
+    forEachWord([&function](int x, int y, uint64_t word) {
+      while (word) {
+        function(x + lowestBit(word), y);
+        word &= word - 1;
+      }
+    });
+  }
+
+private:
+  std::vector<uint64_t> m_words;
+  int m_width;
+  int m_height;
+  int m_wordsPerRow;
+};
+
+}
+
+#endif // _BITMASK_H_
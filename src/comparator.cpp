@@ -22,308 +22,1790 @@
 *  SOFTWARE.                                                                      *
 ***********************************************************************************/
 
+#include <atomic>
 #include <vector>
-#include <map>
 #include <algorithm>
 #include <cassert>
-#include <stack>
-#include <set>
+#include <climits>
+#include <cstring>
+#include <utility>
 
 #include "comparator.h"
+#include "bitmask.h"
+#include "kernels.h"
+#include "parallel.h"
 #include "point.h"
+#include "tileindex.h"
 
 namespace nkar
 {
 
-// Default width and height of the scan rectangle. Each of parameters should be
-// greater or equal to one. Smaller values correspond to the more precise and slower calculations.
-static constexpr int s_scanRectWidth = 1;  // The highest horizontal precision
-static constexpr int s_scanRectHeight = 1; // The highest vertical precision
+//! Merges the pixel rows of a scan rectangle row into the \p merged mask.
+/*!
+  The rectangles cover \p Height + 1 pixel rows starting from \p yMin, clamped to
+  \p yLimit. The common heights are compile time constants, so the loop is unrolled,
+  and the zero \p Height means that the runtime \p height value is used instead.
+*/
+template <int Height>
+static void mergeRows(const kernels::KernelSet &kernelSet, const BitMask &diff, int yMin,
+                      int yLimit, int height, uint64_t *merged)
+{
+  const int rows = Height > 0 ? Height : height;
+  const int count = diff.wordsPerRow();
 
-#if __cplusplus > 201103L
-  // std::max is constexpr starting from c++14
-  static constexpr int s_maxRectDimentinon = std::max(s_scanRectWidth, s_scanRectHeight);
-#else
-  static constexpr int s_maxRectDimentinon = 1;
-#endif
+  std::copy(diff.row(yMin), diff.row(yMin) + count, merged);
+  for (int i = 1; i <= rows; ++i) {
+    if (yMin + i > yLimit) {
+      break;
+    }
+    kernelSet.mergeRow(merged, diff.row(yMin + i), count);
+  }
+}
+
+//! Collects every \p Width-th bit of the \p bits into the lowest bits of the result.
+template <int Width>
+static uint64_t gatherBits(uint64_t bits)
+{
+  uint64_t result = 0;
+  for (int i = 0; i < 64 / Width; ++i) {
+    result |= ((bits >> (i * Width)) & 1) << i;
+  }
+  return result;
+}
 
-class Edge
+template <>
+uint64_t gatherBits<1>(uint64_t bits)
+{
+  return bits;
+}
+
+//! Marks scan rectangles covering the different pixels of the \p merged row.
+/*!
+  A rectangle with the column index c covers pixels from c * width to (c + 1) * width
+  inclusively, so it's dirty if any of these pixels differs. The power of two widths
+  are compile time constants, and whole mask words are processed at once: the bits
+  of pixels of each rectangle are or'ed together with shifts, and then gathered to
+  the rectangle bits. The zero \p Width means that the runtime \p width value is used.
+*/
+template <int Width>
+static void markRects(const uint64_t *merged, int words, int /*width*/, int columns,
+                      uint64_t *rects)
+{
+  static_assert(Width > 0 && Width <= 64 && (Width & (Width - 1)) == 0,
+                "Width should be a power of two");
+
+  const int rectWords = (columns + 63) / 64;
+  const int rectsPerWord = 64 / Width;
+
+  for (int w = 0; w < words; ++w) {
+    const uint64_t bits = merged[w];
+    if (!bits) {
+      continue;
+    }
+
+    // Pixels of each rectangle, except its right border pixel.
+    uint64_t any = bits;
+    for (int shift = 1; shift < Width; shift *= 2) {
+      any |= any >> shift;
+    }
+    const uint64_t dirty = gatherBits<Width>(any);
+    // Left border pixels of rectangles are right border pixels of the previous ones.
+    const uint64_t border = gatherBits<Width>(bits);
+
+    const int column = w * rectsPerWord;
+    const int index = column / 64;
+    if (index < rectWords) {
+      rects[index] |= (dirty | (border >> 1)) << (column % 64);
+    }
+    if ((border & 1) && column > 0) {
+      rects[(column - 1) / 64] |= uint64_t(1) << ((column - 1) % 64);
+    }
+  }
+
+  // The rightmost pixel doesn't start a new rectangle.
+  if (columns % 64) {
+    rects[rectWords - 1] &= (uint64_t(1) << (columns % 64)) - 1;
+  }
+}
+
+template <>
+void markRects<0>(const uint64_t *merged, int words, int width, int columns, uint64_t *rects)
+{
+  for (int w = 0; w < words; ++w) {
+    uint64_t bits = merged[w];
+    while (bits) {
+      const int x = w * 64 + lowestBit(bits);
+      bits &= bits - 1;
+
+      const int column = x / width;
+      if (column < columns) {
+        rects[column / 64] |= uint64_t(1) << (column % 64);
+      }
+      if (x > 0 && x % width == 0) {
+        // The pixel is on the right border of the previous rectangle too.
+        rects[(column - 1) / 64] |= uint64_t(1) << ((column - 1) % 64);
+      }
+    }
+  }
+}
+
+//! Grows the set bits of the \p row of \p count bits by \p radius bits to both sides.
+/*!
+  The bits are spread by shifting whole words, first to the higher positions and
+  then to the lower ones. Each step doubles the spread distance, so the radius is
+  reached in a logarithmic number of steps. The bits are never spread in both
+  directions at once, as the bits shifted out of the row would be lost.
+*/
+static void dilateRow(uint64_t *row, int count, int radius)
+{
+  const int words = (count + 63) / 64;
+
+  for (int spread = 0; spread < radius;) {
+    const int shift = std::min(spread + 1, radius - spread);
+    const int offset = shift / 64;
+    const int bits = shift % 64;
+    // The words are updated in place, so the pass goes against the shift direction.
+    for (int w = words - 1; w >= offset; --w) {
+      uint64_t word = row[w - offset] << bits;
+      if (bits && w - offset > 0) {
+        word |= row[w - offset - 1] >> (64 - bits);
+      }
+      row[w] |= word;
+    }
+    spread += shift;
+  }
+  if (count % 64) {
+    row[words - 1] &= (uint64_t(1) << (count % 64)) - 1;
+  }
+
+  for (int spread = 0; spread < radius;) {
+    const int shift = std::min(spread + 1, radius - spread);
+    const int offset = shift / 64;
+    const int bits = shift % 64;
+    for (int w = 0; w + offset < words; ++w) {
+      uint64_t word = row[w + offset] >> bits;
+      if (bits && w + offset + 1 < words) {
+        word |= row[w + offset + 1] << (64 - bits);
+      }
+      row[w] |= word;
+    }
+    spread += shift;
+  }
+}
+
+//! Grows the set bits of the \p mask by \p radius bits in each direction.
+/*!
+  The dilation is separable: rows are grown horizontally in place first, and then
+  the rows are spread vertically the same way as bits of a row, i.e. downwards and
+  then upwards with the spread distance doubling each step. Each step merges the
+  rows at the shift distance into a copy of the mask, so the rows are processed in
+  parallel bands.
+*/
+static void dilate(BitMask &mask, int radius, int threads)
+{
+  const auto &kernelSet = kernels::active();
+
+  forEachBand(mask.height(), threads, [&](int, int begin, int end) {
+    for (int row = begin; row < end; ++row) {
+      dilateRow(mask.row(row), mask.width(), radius);
+    }
+  });
+
+  BitMask dilated(mask.width(), mask.height());
+  for (const int direction : { 1, -1 }) {
+    for (int spread = 0; spread < radius;) {
+      const int shift = std::min(spread + 1, radius - spread);
+      forEachBand(mask.height(), threads, [&](int, int begin, int end) {
+        for (int row = begin; row < end; ++row) {
+          uint64_t *words = dilated.row(row);
+          std::copy(mask.row(row), mask.row(row) + mask.wordsPerRow(), words);
+          const int source = row - direction * shift;
+          if (source >= 0 && source < mask.height()) {
+            kernelSet.mergeRow(words, mask.row(source), mask.wordsPerRow());
+          }
+        }
+      });
+      std::swap(mask, dilated);
+      spread += shift;
+    }
+  }
+}
+
+//! Returns the merge radius of the \p options limited by the grid with the given dimensions.
+/*!
+  Larger radii grow the dirty rectangles over the whole grid, so they merge the same
+  differences.
+*/
+static int mergeRadius(const Options &options, int columns, int rows)
+{
+  return std::min(options.mergeRadius(), std::max(columns, rows));
+}
+
+//! Implements the grid of scan rectangles.
+/*!
+  The scan rectangles tile the image from left to right and from top to bottom -
+  this is scanning order. Neighbor rectangles share their border pixels, i.e. a
+  rectangle with the origin (x, y) covers pixels from x to x + width and from
+  y to y + height inclusively, clamped to the image bounds. A rectangle is dirty
+  if at least one of the pixels it covers differs.
+*/
+class ScanGrid
 {
 public:
-  Edge(const Point &begin, const Point &end)
+  ScanGrid(int imageWidth, int imageHeight, int rectWidth, int rectHeight)
     :
-      m_begin(begin),
-      m_end(end)
+      m_rectWidth(rectWidth),
+      m_rectHeight(rectHeight),
+      m_xLimit(imageWidth - 1),
+      m_yLimit(imageHeight - 1),
+      m_columns((std::max(m_xLimit, 0) + rectWidth - 1) / rectWidth),
+      m_rows((std::max(m_yLimit, 0) + rectHeight - 1) / rectHeight),
+      m_mergeRows(selectMergeRows(rectHeight)),
+      m_markRects(selectMarkRects(rectWidth))
   {
-    assert(m_begin < m_end);
+    assert(rectWidth > 0 && rectHeight > 0);
   }
 
-  bool operator<(const Edge &other) const
+  //! Returns the number of scan rectangles in each row of the grid.
+  int columns() const
   {
-    if (m_begin.x() < other.m_begin.x()) {
-      return true;
-    } else if (m_begin.x() == other.m_begin.x()) {
-      if (m_begin.y() < other.m_begin.y()) {
-        return true;
-      } else if (m_begin.y() == other.m_begin.y()) {
-        if (m_end.x() < other.m_end.x()) {
-          return true;
-        } else if (m_end.x() == other.m_end.x()) {
-          return m_end.y() < other.m_end.y();
+    return m_columns;
+  }
+
+  //! Returns the number of rows of the grid.
+  int rows() const
+  {
+    return m_rows;
+  }
+
+  //! Returns the corner of the grid lattice with the given indexes.
+  /*!
+    The scan rectangle (column, row) has the upper left corner (column, row) and
+    the lower right corner (column + 1, row + 1).
+  */
+  Point corner(int column, int row) const
+  {
+    return Point(std::min(column * m_rectWidth, m_xLimit), std::min(row * m_rectHeight, m_yLimit));
+  }
+
+  //! Finds dirty scan rectangles for the given pixel difference mask.
+  /*!
+    Scans the grid rows from \p rowBegin to \p rowEnd (exclusive) and sets the
+    bits of dirty rectangles in the \p rects mask, that has one bit per scan rectangle.
+  */
+  void scan(const BitMask &diff, int rowBegin, int rowEnd, BitMask &rects) const
+  {
+    const auto &kernelSet = kernels::active();
+
+    std::vector<uint64_t> merged(diff.wordsPerRow());
+
+    for (int row = rowBegin; row < rowEnd; ++row) {
+      // Merge all pixel rows covered by this row of rectangles.
+      m_mergeRows(kernelSet, diff, row * m_rectHeight, m_yLimit, m_rectHeight, merged.data());
+      // Mark the rectangles covering each failed pixel.
+      mark(merged.data(), diff.wordsPerRow(), rects.row(row));
+    }
+  }
+
+  //! Returns the range of pixel rows, that the given row of rectangles covers.
+  std::pair<int, int> pixelRows(int row) const
+  {
+    return std::make_pair(row * m_rectHeight, std::min((row + 1) * m_rectHeight, m_yLimit));
+  }
+
+  //! Returns the range of pixel rows, that are assigned to the given row of rectangles.
+  /*!
+    Each pixel is assigned to one of the rectangles covering it, so that rectangles
+    don't share the assigned pixels: the pixels on the border of two rectangles are
+    assigned to the lower or the right one, unless it's the last row or column.
+  */
+  std::pair<int, int> assignedPixelRows(int row) const
+  {
+    return std::make_pair(row * m_rectHeight,
+                          row + 1 < m_rows ? (row + 1) * m_rectHeight - 1 : m_yLimit);
+  }
+
+  //! Returns the range of pixel columns, that are assigned to the given column of rectangles.
+  std::pair<int, int> assignedPixelColumns(int column) const
+  {
+    return std::make_pair(column * m_rectWidth,
+                          column + 1 < m_columns ? (column + 1) * m_rectWidth - 1 : m_xLimit);
+  }
+
+  //! Marks dirty rectangles of a row for the merged difference bits of its pixel rows.
+  /*!
+    The \p merged row has \p words words, and the \p rects row has one bit per column.
+  */
+  void mark(const uint64_t *merged, int words, uint64_t *rects) const
+  {
+    m_markRects(merged, words, m_rectWidth, m_columns, rects);
+  }
+
+private:
+  using MergeRowsFunction = void (*)(const kernels::KernelSet &, const BitMask &, int, int, int,
+                                     uint64_t *);
+  using MarkRectsFunction = void (*)(const uint64_t *, int, int, int, uint64_t *);
+
+  //! Returns the row merging function specialized for the given rectangle height.
+  static MergeRowsFunction selectMergeRows(int height)
+  {
+    switch (height)
+    {
+    case 1:  return mergeRows<1>;
+    case 2:  return mergeRows<2>;
+    case 4:  return mergeRows<4>;
+    case 8:  return mergeRows<8>;
+    case 16: return mergeRows<16>;
+    default: return mergeRows<0>;
+    }
+  }
+
+  //! Returns the rectangle marking function specialized for the given rectangle width.
+  static MarkRectsFunction selectMarkRects(int width)
+  {
+    switch (width)
+    {
+    case 1:  return markRects<1>;
+    case 2:  return markRects<2>;
+    case 4:  return markRects<4>;
+    case 8:  return markRects<8>;
+    case 16: return markRects<16>;
+    default: return markRects<0>;
+    }
+  }
+
+  int m_rectWidth;
+  int m_rectHeight;
+  int m_xLimit;
+  int m_yLimit;
+  int m_columns;
+  int m_rows;
+  MergeRowsFunction m_mergeRows;
+  MarkRectsFunction m_markRects;
+};
+
+//! Calls the \p function with the index of each set bit of the given \p row of the \p mask.
+template <typename Function>
+static void forEachSetBit(const BitMask &mask, int row, Function function)
+{
+  const uint64_t *words = mask.row(row);
+  for (int w = 0; w < mask.wordsPerRow(); ++w) {
+    uint64_t bits = words[w];
+    while (bits) {
+      function(w * 64 + lowestBit(bits));
+      bits &= bits - 1;
+    }
+  }
+}
+
+//! Calls the \p function as <tt>function(begin, end)</tt> for each run of set bits.
+/*!
+  The \p row has \p words words. The bounds of the runs are found as the bits, that
+  differ from their lower neighbors.
+*/
+template <typename Function>
+static void forEachRun(const uint64_t *row, int words, Function function)
+{
+  int begin = -1;
+  for (int w = 0; w < words; ++w) {
+    const uint64_t carry = w > 0 ? row[w - 1] >> 63 : 0;
+    uint64_t bounds = row[w] ^ ((row[w] << 1) | carry);
+    while (bounds) {
+      const int bit = w * 64 + lowestBit(bounds);
+      bounds &= bounds - 1;
+      if (begin < 0) {
+        begin = bit;
+      } else {
+        function(begin, bit);
+        begin = -1;
+      }
+    }
+  }
+  if (begin >= 0) {
+    function(begin, words * 64);
+  }
+}
+
+//! Returns the root of the given \p label in the union-find structure of \p parents.
+/*!
+  The labels on the path to the root are linked to the root directly.
+*/
+static uint32_t find(std::vector<uint32_t> &parents, uint32_t label)
+{
+  uint32_t root = label;
+  while (parents[root] != root) {
+    root = parents[root];
+  }
+  while (parents[label] != root) {
+    const uint32_t parent = parents[label];
+    parents[label] = root;
+    label = parent;
+  }
+  return root;
+}
+
+//! Implements the difference contours - outlines of connected dirty scan rectangles.
+/*!
+  An edge of a scan rectangle is a part of an outline if exactly one of the rectangles
+  it separates is dirty. The outline edges connect corners of the grid lattice, and
+  a contour is a connected component of the graph of the outline edges: the outer
+  outline of a group of dirty rectangles, that touch each other at least by corners,
+  together with the outlines of holes, that touch it. A group consists of its outer
+  contour and the contours of its holes, that don't touch the outer one.
+*/
+class ContourFinder
+{
+public:
+  //! Constructs the contour finder of the given \p grid and its dirty \p rects.
+  ContourFinder(const ScanGrid &grid, const BitMask &rects)
+    :
+      m_grid(grid),
+      m_rects(rects)
+  {}
+
+  //! Extracts the outline edges of the dirty rectangles.
+  /*!
+    The edges are found by xor'ing the neighbor bits of the rectangles mask word by
+    word. The rows are processed in parallel bands.
+  */
+  void findEdges(int threads)
+  {
+    const BitMask &rects = m_rects;
+    const int columns = m_grid.columns();
+    const int rows = m_grid.rows();
+
+    // The horizontal edges of each lattice row, the vertical edges of each grid row
+    // and corners of the lattice the edges begin or end at.
+    m_horizontal = BitMask(columns, rows + 1);
+    m_vertical = BitMask(columns + 1, rows);
+    m_corners = BitMask(columns + 1, rows + 1);
+
+    forEachBand(rows + 1, threads, [&](int, int begin, int end) {
+      for (int line = begin; line < end; ++line) {
+        const uint64_t *above = line > 0 ? rects.row(line - 1) : nullptr;
+        const uint64_t *below = line < rows ? rects.row(line) : nullptr;
+        uint64_t *edges = m_horizontal.row(line);
+        for (int w = 0; w < rects.wordsPerRow(); ++w) {
+          edges[w] = (above ? above[w] : 0) ^ (below ? below[w] : 0);
+        }
+
+        if (below) {
+          edges = m_vertical.row(line);
+          for (int w = 0; w < m_vertical.wordsPerRow(); ++w) {
+            const uint64_t word = w < rects.wordsPerRow() ? below[w] : 0;
+            const uint64_t carry = w > 0 ? below[w - 1] >> 63 : 0;
+            edges[w] = word ^ ((word << 1) | carry);
+          }
+        }
+      }
+    });
+
+    forEachBand(rows + 1, threads, [&](int, int begin, int end) {
+      for (int line = begin; line < end; ++line) {
+        const uint64_t *horizontal = m_horizontal.row(line);
+        const uint64_t *up = line > 0 ? m_vertical.row(line - 1) : nullptr;
+        const uint64_t *down = line < rows ? m_vertical.row(line) : nullptr;
+        uint64_t *corners = m_corners.row(line);
+        for (int w = 0; w < m_corners.wordsPerRow(); ++w) {
+          // A horizontal edge begins at its corner and ends at the next one.
+          const uint64_t word = w < m_horizontal.wordsPerRow() ? horizontal[w] : 0;
+          const uint64_t carry = w > 0 ? horizontal[w - 1] >> 63 : 0;
+          corners[w] = word | (word << 1) | carry | (up ? up[w] : 0) | (down ? down[w] : 0);
+        }
+      }
+    });
+  }
+
+  //! Finds the contours and returns their number.
+  /*!
+    Implements the two pass connected component labelling of the lattice corners.
+    The first pass visits the corners in raster order and assigns each one the
+    provisional label of its left or upper neighbor, if it's connected with them by
+    an edge, or a new label otherwise. Equivalent labels are recorded with the
+    union-find structure. The second pass replaces provisional labels with the final
+    ones, numbered in order of the first contour corners in raster order.
+
+    The lattice rows are split into bands labelled in parallel, each with its own
+    union-find structure. Then the labels of the bands are stitched together along
+    the band borders with the lock-free union-find, that always links the larger
+    root to the smaller one. As labels are increasing in raster order, the root of
+    each contour is its first label, so the final labels don't depend on the number
+    of bands.
+
+    Finally the contours are united into groups: both vertical edges of a run of dirty
+    rectangles in a row belong to the same group, and each hole is linked this way to
+    a contour, that reaches farther to the left, down to the outer contour of its group.
+    The groups are numbered in order of their outer contours, which are their first
+    contours.
+  */
+  size_t label(int threads)
+  {
+    const int lines = m_grid.rows() + 1;
+    std::vector<Band> bands(bandCount(lines, threads));
+
+    // Each band writes the labels of its corners to its own part of the array.
+    m_lineOffsets.assign(lines + 1, 0);
+    forEachBand(lines, threads, [&](int band, int begin, int end) {
+      bands[band].begin = begin;
+      bands[band].end = end;
+      for (int line = begin; line < end; ++line) {
+        for (int w = 0; w < m_corners.wordsPerRow(); ++w) {
+          m_lineOffsets[line + 1] += bitCount(m_corners.row(line)[w]);
+        }
+        bands[band].corners += m_lineOffsets[line + 1];
+      }
+    });
+    for (int line = 0; line < lines; ++line) {
+      m_lineOffsets[line + 1] += m_lineOffsets[line];
+    }
+    for (auto &band : bands) {
+      band.cornerOffset = m_lineOffsets[band.begin];
+    }
+    m_labels.resize(m_lineOffsets.back());
+
+    forEachBand(lines, threads, [&](int band, int, int) {
+      labelBand(bands[band]);
+    });
+
+    uint32_t labels = 0;
+    for (auto &band : bands) {
+      band.labelOffset = labels;
+      labels += (uint32_t)band.parents.size();
+    }
+
+    // The global union-find structure with all labels pointing to roots of their bands.
+    std::vector<std::atomic<uint32_t>> parents(labels);
+    forEachBand(lines, threads, [&](int index, int, int) {
+      Band &band = bands[index];
+      for (uint32_t label = 0; label < band.parents.size(); ++label) {
+        parents[band.labelOffset + label] = band.labelOffset + find(band.parents, label);
+      }
+    });
+
+    // Stitch the corners connected by vertical edges across band borders.
+    forEachBand(lines, threads, [&](int index, int begin, int) {
+      if (index == 0) {
+        return;
+      }
+      const Band &band = bands[index];
+      const Band &above = bands[index - 1];
+      forEachSetBit(m_vertical, begin - 1, [&](int column) {
+        unite(parents, band.labelOffset + band.first[column],
+              above.labelOffset + above.last[column]);
+      });
+    });
+
+    // Number contours in order of their roots.
+    std::vector<uint32_t> components(labels);
+    forEachBand(lines, threads, [&](int index, int, int) {
+      const Band &band = bands[index];
+      for (uint32_t label = band.labelOffset; label < band.labelOffset + band.parents.size();
+           ++label) {
+        components[label] = root(parents, label);
+      }
+    });
+    // The contours, that begin before each label.
+    std::vector<uint32_t> firstContours(labels + 1);
+    uint32_t count = 0;
+    for (uint32_t label = 0; label < labels; ++label) {
+      firstContours[label] = count;
+      components[label] = components[label] == label ? count++ : components[components[label]];
+    }
+    firstContours[labels] = count;
+
+    forEachBand(lines, threads, [&](int index, int, int) {
+      const Band &band = bands[index];
+      for (size_t i = band.cornerOffset; i < band.cornerOffset + band.corners; ++i) {
+        m_labels[i] = components[band.labelOffset + m_labels[i]];
+      }
+    });
+
+    // Unite the contours of the edges of the runs.
+    std::vector<std::atomic<uint32_t>> groups(count);
+    for (uint32_t contour = 0; contour < count; ++contour) {
+      groups[contour] = contour;
+    }
+    forEachBand(m_grid.rows(), threads, [&](int, int begin, int end) {
+      for (int row = begin; row < end; ++row) {
+        forEachRunEdges(row, [&](int, int, uint32_t left, uint32_t right) {
+          if (left != right) {
+            unite(groups, left, right);
+          }
+        });
+      }
+    });
+
+    // A parent of a contour precedes it, so its group is already numbered.
+    std::vector<uint32_t> firstGroups(count + 1);
+    m_groups.resize(count);
+    m_groupCount = 0;
+    for (uint32_t contour = 0; contour < count; ++contour) {
+      firstGroups[contour] = m_groupCount;
+      const uint32_t parent = groups[contour];
+      m_groups[contour] = parent == contour ? m_groupCount++ : m_groups[parent];
+    }
+    firstGroups[count] = m_groupCount;
+
+    // A group begins on the line of the first corner of its outer contour.
+    m_lineGroups.assign(lines + 1, m_groupCount);
+    for (const auto &band : bands) {
+      for (int line = band.begin; line < band.end; ++line) {
+        m_lineGroups[line] =
+          firstGroups[firstContours[band.labelOffset + band.lineLabels[line - band.begin]]];
+      }
+    }
+
+    return count;
+  }
+
+  //! Returns the number of groups. Labelling should be done before.
+  size_t groupCount() const
+  {
+    return m_groupCount;
+  }
+
+  //! Returns the index of the first group, that begins on the given lattice \p line or below.
+  /*!
+    The groups, that begin above the \p line, have smaller indexes. Labelling should be
+    done before.
+  */
+  uint32_t firstGroup(int line) const
+  {
+    return m_lineGroups[line];
+  }
+
+  //! Calls the \p function as <tt>function(begin, end, group)</tt> for each run of rectangles.
+  /*!
+    The runs of dirty rectangles of the \p row are reported from left to right, \c begin
+    and \c end are the columns of the first rectangle of the run and the one after the
+    last. Labelling should be done before.
+  */
+  template <typename Function>
+  void forEachRun(int row, Function function) const
+  {
+    forEachRunEdges(row, [&](int begin, int end, uint32_t left, uint32_t) {
+      function(begin, end, m_groups[left]);
+    });
+  }
+
+  //! Drops the groups, that aren't \p kept, and returns the number of remaining contours.
+  /*!
+    The contours are renumbered, so that the contours of the remaining groups keep their
+    order and precede the contours of the dropped ones. The groups keep their indexes.
+  */
+  size_t keepGroups(const std::vector<bool> &kept, int threads)
+  {
+    std::vector<uint32_t> contours(m_groups.size());
+    uint32_t count = 0;
+    for (uint32_t contour = 0; contour < contours.size(); ++contour) {
+      if (kept[m_groups[contour]]) {
+        contours[contour] = count++;
+      }
+    }
+    const size_t remaining = count;
+    std::vector<uint32_t> groups(m_groups.size());
+    for (uint32_t contour = 0; contour < contours.size(); ++contour) {
+      if (!kept[m_groups[contour]]) {
+        contours[contour] = count++;
+      }
+      groups[contours[contour]] = m_groups[contour];
+    }
+    m_groups = std::move(groups);
+
+    forEachBand((int)m_lineOffsets.size() - 1, threads, [&](int, int begin, int end) {
+      for (size_t i = m_lineOffsets[begin]; i < m_lineOffsets[end]; ++i) {
+        m_labels[i] = contours[m_labels[i]];
+      }
+    });
+    return remaining;
+  }
+
+  //! Calls the \p function as <tt>function(begin, end, contour)</tt> for each outline edge.
+  /*!
+    The \c contour is the index of the contour the edge belongs to. Labelling should be
+    done before.
+  */
+  template <typename Function>
+  void forEachEdge(Function function) const
+  {
+    size_t index = 0;
+    for (int line = 0; line <= m_grid.rows(); ++line) {
+      forEachSetBit(m_corners, line, [&](int column) {
+        const uint32_t contour = m_labels[index++];
+        const Point corner = m_grid.corner(column, line);
+        if (column < m_grid.columns() && m_horizontal.test(column, line)) {
+          function(corner, m_grid.corner(column + 1, line), contour);
+        }
+        if (line < m_grid.rows() && m_vertical.test(column, line)) {
+          function(corner, m_grid.corner(column, line + 1), contour);
+        }
+      });
+    }
+  }
+
+  //! Traces the outlines of the first \p count contours and returns them as polygons.
+  /*!
+    The outlines are followed edge by edge with the different rectangles on the
+    right-hand side. At the corners, where two different rectangles touch each other
+    diagonally, the outline turns left, i.e. passes to the other rectangle. Each
+    polygon starts from its first horizontal edge in raster order, and all the
+    traced horizontal edges are marked, so the next polygon starts from the next
+    unmarked one. Labelling should be done before.
+
+    The parent of a polygon is found when it starts: it's the innermost of already
+    traced polygons, that encloses the rectangle above the first edge. Polygons are
+    started in raster order, so all polygons enclosing that rectangle are traced
+    by then.
+  */
+  Contours polygons(size_t count) const
+  {
+    Contours polygons;
+    BitMask remaining(m_horizontal);
+    EdgeMap owners(m_vertical);
+    std::vector<Traced> traced;
+
+    for (int line = 0; line <= m_grid.rows(); ++line) {
+      uint64_t *words = remaining.row(line);
+      for (int w = 0; w < remaining.wordsPerRow(); ++w) {
+        // The word changes while tracing.
+        while (words[w]) {
+          const int column = w * 64 + lowestBit(words[w]);
+          const bool hole = !isDirty(column, line);
+          const int start = hole ? column + 1 : column;
+          const size_t contour = labelOf(start, line);
+
+          Traced polygon;
+          polygon.parent = enclosing(column, line - 1, owners, traced);
+          polygon.hole = hole;
+          polygon.index = s_none;
+          if (contour < count) {
+            // The enclosing polygons of dropped groups are skipped.
+            uint32_t parent = polygon.parent;
+            while (parent != s_none && traced[parent].index == s_none) {
+              parent = traced[parent].parent;
+            }
+            polygon.index = (uint32_t)polygons.size();
+            polygons.addPolygon(contour, hole,
+                                parent == s_none ? Contours::npos : traced[parent].index);
+          }
+          traced.push_back(polygon);
+
+          trace(start, line, hole ? West : East, contour < count,
+                (uint32_t)traced.size() - 1, remaining, owners, polygons);
+        }
+      }
+    }
+
+    return polygons;
+  }
+
+private:
+  //! The band of lattice rows labelled independently.
+  struct Band
+  {
+    int begin{ 0 };
+    int end{ 0 };
+    //! The number of corners in the band and the index of the first one.
+    size_t corners{ 0 };
+    size_t cornerOffset{ 0 };
+    //! The union-find structure of the band labels and the first global label.
+    std::vector<uint32_t> parents;
+    uint32_t labelOffset{ 0 };
+    //! The labels of corners of the first and the last rows of the band.
+    std::vector<uint32_t> first;
+    std::vector<uint32_t> last;
+    //! The number of labels created before each row of the band.
+    std::vector<uint32_t> lineLabels;
+  };
+
+  static constexpr uint32_t s_none = UINT32_MAX;
+
+  //! A traced polygon.
+  struct Traced
+  {
+    //! The index of the enclosing polygon.
+    uint32_t parent;
+    //! The index of the polygon in the result or s_none if it's not added there.
+    uint32_t index;
+    bool hole;
+  };
+
+  //! Implements a map from the set bits of a mask to values.
+  /*!
+    The values are stored in raster order of the bits, and the index of the value of
+    a bit is the number of set bits before it, that is counted with the prefix sums
+    of set bits of the mask words.
+  */
+  class EdgeMap
+  {
+  public:
+    explicit EdgeMap(const BitMask &edges)
+      :
+        m_edges(edges),
+        m_offsets((size_t)edges.height() * edges.wordsPerRow() + 1, 0)
+    {
+      for (int row = 0; row < edges.height(); ++row) {
+        const uint64_t *words = edges.row(row);
+        for (int w = 0; w < edges.wordsPerRow(); ++w) {
+          const size_t index = (size_t)row * edges.wordsPerRow() + w;
+          m_offsets[index + 1] = m_offsets[index] + bitCount(words[w]);
+        }
+      }
+      m_values.resize(m_offsets.back());
+    }
+
+    //! Returns the value of the set bit at the given position.
+    uint32_t &operator()(int column, int row)
+    {
+      return m_values[index(column, row)];
+    }
+
+    uint32_t operator()(int column, int row) const
+    {
+      return m_values[index(column, row)];
+    }
+
+  private:
+    size_t index(int column, int row) const
+    {
+      assert(m_edges.test(column, row));
+      const uint64_t word = m_edges.row(row)[column / 64];
+      return m_offsets[(size_t)row * m_edges.wordsPerRow() + column / 64] +
+             bitCount(word & ((uint64_t(1) << (column % 64)) - 1));
+    }
+
+    const BitMask &m_edges;
+    std::vector<uint32_t> m_offsets;
+    std::vector<uint32_t> m_values;
+  };
+
+  //! Returns the innermost of the \p traced polygons, that encloses the given rectangle.
+  /*!
+    The nearest vertical edge on the left of the rectangle belongs to a polygon, that
+    either encloses the rectangle or is enclosed by the same polygon as the rectangle.
+    The polygon encloses the rectangles on its inner side, which is the different side
+    for outer outlines and the clean side for holes.
+  */
+  uint32_t enclosing(int column, int row, const EdgeMap &owners,
+                     const std::vector<Traced> &traced) const
+  {
+    if (row < 0) {
+      return s_none;
+    }
+
+    const uint64_t *words = m_vertical.row(row);
+    int w = column / 64;
+    uint64_t bits = words[w] & (~uint64_t(0) >> (63 - column % 64));
+    while (!bits && w > 0) {
+      bits = words[--w];
+    }
+    if (!bits) {
+      return s_none;
+    }
+
+    const int edge = w * 64 + highestBit(bits);
+    const uint32_t polygon = owners(edge, row);
+    return isDirty(edge, row) != traced[polygon].hole ? polygon : traced[polygon].parent;
+  }
+
+  //! Implements the first labelling pass over the corners of the \p band.
+  /*!
+    The band labels its corners with its own labels starting from zero.
+  */
+  void labelBand(Band &band)
+  {
+    std::vector<uint32_t> previous(m_grid.columns() + 1);
+    std::vector<uint32_t> current(m_grid.columns() + 1);
+    uint32_t *labels = m_labels.data() + band.cornerOffset;
+
+    for (int line = band.begin; line < band.end; ++line) {
+      band.lineLabels.push_back((uint32_t)band.parents.size());
+      uint32_t left = 0;
+      forEachSetBit(m_corners, line, [&](int column) {
+        const bool hasLeft = column > 0 && m_horizontal.test(column - 1, line);
+        const bool hasUp = line > band.begin && m_vertical.test(column, line - 1);
+
+        uint32_t label;
+        if (hasLeft && hasUp) {
+          label = unite(band.parents, left, previous[column]);
+        } else if (hasLeft) {
+          label = left;
+        } else if (hasUp) {
+          label = previous[column];
+        } else {
+          label = (uint32_t)band.parents.size();
+          band.parents.push_back(label);
+        }
+
+        current[column] = label;
+        left = label;
+        *labels++ = label;
+      });
+
+      if (line == band.begin) {
+        band.first = current;
+      }
+      std::swap(previous, current);
+    }
+    band.last = std::move(previous);
+  }
+
+  //! The directions of outline edges, clockwise.
+  enum Direction
+  {
+    East,
+    South,
+    West,
+    North
+  };
+
+  //! Returns true if the given scan rectangle is dirty.
+  bool isDirty(int column, int row) const
+  {
+    return column >= 0 && column < m_grid.columns() && row >= 0 && row < m_grid.rows() &&
+           m_rects.test(column, row);
+  }
+
+  //! Returns true if an outline edge goes from the given corner in the \p direction.
+  bool hasEdge(int column, int line, Direction direction) const
+  {
+    // The dirty rectangle is on the right-hand side of the edge.
+    switch (direction)
+    {
+    case East:
+      return column < m_grid.columns() && m_horizontal.test(column, line) &&
+             isDirty(column, line);
+    case South:
+      return line < m_grid.rows() && m_vertical.test(column, line) &&
+             isDirty(column - 1, line);
+    case West:
+      return column > 0 && m_horizontal.test(column - 1, line) &&
+             isDirty(column - 1, line - 1);
+    default:
+      return line > 0 && m_vertical.test(column, line - 1) && isDirty(column, line - 1);
+    }
+  }
+
+  //! Calls the \p function as <tt>function(begin, end, left, right)</tt> for each run.
+  /*!
+    The runs of dirty rectangles of the \p row are reported from left to right, and
+    the \c left and \c right are the contours of the vertical edges on both sides of the
+    run. The vertical edges of a row alternate between the left and the right ones,
+    and the contour of an edge is the label of its upper corner.
+  */
+  template <typename Function>
+  void forEachRunEdges(int row, Function function) const
+  {
+    const uint64_t *edges = m_vertical.row(row);
+    const uint64_t *corners = m_corners.row(row);
+    size_t index = m_lineOffsets[row];
+    int begin = -1;
+    uint32_t left = 0;
+    for (int w = 0; w < m_vertical.wordsPerRow(); ++w) {
+      uint64_t bits = edges[w];
+      while (bits) {
+        const int bit = lowestBit(bits);
+        bits &= bits - 1;
+        const uint32_t contour =
+          m_labels[index + bitCount(corners[w] & ((uint64_t(1) << bit) - 1))];
+        if (begin < 0) {
+          begin = w * 64 + bit;
+          left = contour;
+        } else {
+          function(begin, w * 64 + bit, left, contour);
+          begin = -1;
+        }
+      }
+      index += bitCount(corners[w]);
+    }
+  }
+
+  //! Returns the label of the given corner.
+  uint32_t labelOf(int column, int line) const
+  {
+    const uint64_t *words = m_corners.row(line);
+    size_t index = m_lineOffsets[line];
+    for (int w = 0; w < column / 64; ++w) {
+      index += bitCount(words[w]);
+    }
+    index += bitCount(words[column / 64] & ((uint64_t(1) << (column % 64)) - 1));
+    return m_labels[index];
+  }
+
+  //! Traces the \p polygon starting from the given corner in the given \p direction.
+  /*!
+    The vertical edges of the polygon are marked in the \p owners map. The vertices
+    are appended to the last polygon of the \p polygons if \p add is true.
+  */
+  void trace(int column, int line, Direction direction, bool add, uint32_t polygon,
+             BitMask &remaining, EdgeMap &owners, Contours &polygons) const
+  {
+    static const int s_dx[] = { 1, 0, -1, 0 };
+    static const int s_dy[] = { 0, 1, 0, -1 };
+
+    const int startColumn = column;
+    const int startLine = line;
+    const Direction startDirection = direction;
+    do {
+      switch (direction)
+      {
+      case East:
+        remaining.row(line)[column / 64] &= ~(uint64_t(1) << (column % 64));
+        break;
+      case South:
+        owners(column, line) = polygon;
+        break;
+      case West:
+        remaining.row(line)[(column - 1) / 64] &= ~(uint64_t(1) << ((column - 1) % 64));
+        break;
+      default:
+        owners(column, line - 1) = polygon;
+        break;
+      }
+      column += s_dx[direction];
+      line += s_dy[direction];
+
+      // Turn left if possible, then go straight or turn right.
+      Direction next = Direction((direction + 3) % 4);
+      if (!hasEdge(column, line, next)) {
+        next = direction;
+        if (!hasEdge(column, line, next)) {
+          next = Direction((direction + 1) % 4);
+        }
+      }
+      assert(hasEdge(column, line, next));
+
+      if (next != direction && add) {
+        polygons.addVertex(m_grid.corner(column, line));
+      }
+      direction = next;
+    } while (column != startColumn || line != startLine || direction != startDirection);
+  }
+
+  //! Merges sets of two labels and returns the root, that is the smaller label.
+  static uint32_t unite(std::vector<uint32_t> &parents, uint32_t label1, uint32_t label2)
+  {
+    const uint32_t root1 = find(parents, label1);
+    const uint32_t root2 = find(parents, label2);
+    const uint32_t root = std::min(root1, root2);
+    parents[root1] = root;
+    parents[root2] = root;
+    return root;
+  }
+
+  //! Returns the root of the given \p label in the shared union-find structure.
+  static uint32_t root(const std::vector<std::atomic<uint32_t>> &parents, uint32_t label)
+  {
+    uint32_t parent;
+    while ((parent = parents[label].load()) != label) {
+      label = parent;
+    }
+    return label;
+  }
+
+  //! Merges sets of two labels in the shared union-find structure.
+  /*!
+    The larger root is linked to the smaller one with the compare-and-swap operation,
+    that fails if the larger root was linked by another thread meanwhile.
+  */
+  static void unite(std::vector<std::atomic<uint32_t>> &parents, uint32_t label1,
+                    uint32_t label2)
+  {
+    while (true) {
+      uint32_t root1 = root(parents, label1);
+      uint32_t root2 = root(parents, label2);
+      if (root1 == root2) {
+        return;
+      }
+      if (root1 > root2) {
+        std::swap(root1, root2);
+      }
+      if (parents[root2].compare_exchange_weak(root2, root1)) {
+        return;
+      }
+    }
+  }
+
+  const ScanGrid &m_grid;
+  const BitMask &m_rects;
+  BitMask m_horizontal;
+  BitMask m_vertical;
+  BitMask m_corners;
+  //! The labels of the corners in raster order and indexes of first corners of rows.
+  std::vector<uint32_t> m_labels;
+  std::vector<size_t> m_lineOffsets;
+  //! The groups of the contours and indexes of the first groups of lines.
+  std::vector<uint32_t> m_groups;
+  std::vector<uint32_t> m_lineGroups;
+  size_t m_groupCount{ 0 };
+};
+
+constexpr uint32_t ContourFinder::s_none;
+
+//! Implements accumulation of statistics of different pixels.
+struct PixelStatistics
+{
+  size_t count{ 0 };
+  //! The bounding box of the pixels.
+  int left{ INT_MAX };
+  int top{ INT_MAX };
+  int right{ -1 };
+  int bottom{ -1 };
+  //! The sums of the coordinates of the pixels.
+  uint64_t sumX{ 0 };
+  uint64_t sumY{ 0 };
+  //! The maximum and the sum of the red, green and blue deltas.
+  uint8_t maxDelta[3]{};
+  uint64_t sumDelta[3]{};
+
+  //! Adds the pixels of the \p other statistics.
+  void merge(const PixelStatistics &other)
+  {
+    count += other.count;
+    left = std::min(left, other.left);
+    top = std::min(top, other.top);
+    right = std::max(right, other.right);
+    bottom = std::max(bottom, other.bottom);
+    sumX += other.sumX;
+    sumY += other.sumY;
+    for (int channel = 0; channel < 3; ++channel) {
+      maxDelta[channel] = std::max(maxDelta[channel], other.maxDelta[channel]);
+      sumDelta[channel] += other.sumDelta[channel];
+    }
+  }
+
+  static uint8_t delta(uint8_t value1, uint8_t value2)
+  {
+    return value1 > value2 ? value1 - value2 : value2 - value1;
+  }
+};
+
+//! Implements the streaming search of groups of dirty scan rectangles.
+/*!
+  A group is a connected component of dirty rectangles, that touch each other at least
+  by corners. The rows of the rectangles mask are labelled one by one in scanning order,
+  and only the labels of the previous row and the groups, that reach it, are kept. The
+  labels are renumbered after each row, so a group, that doesn't reach the current row,
+  is complete and is moved to the complete groups. Thus the memory usage is proportional
+  to the grid width only. The statistics of different pixels of the rectangles are
+  accumulated in the groups, while the labels of their row are known.
+
+  The groups, that touch the first row or reach the last one, may continue in the
+  neighbor bands of rows, so they remain open to be stitched with them.
+*/
+class GroupFinder
+{
+public:
+  //! A group of dirty rectangles.
+  struct Group
+  {
+    //! The bounding box in the grid coordinates.
+    int left;
+    int top;
+    int right;
+    int bottom;
+    //! The scanning order index of the first rectangle of the group.
+    uint64_t first;
+    //! The statistics of the different pixels of the rectangles.
+    PixelStatistics pixels;
+  };
+
+  //! Constructs the finder for a band of rows of the grid with the given number of \p columns.
+  GroupFinder(int columns)
+    :
+      m_columns(columns),
+      m_words((columns + 63) / 64),
+      m_previous(columns, s_none),
+      m_current(columns, s_none),
+      m_firstLabels(columns, s_none),
+      m_firstRects(m_words, 0),
+      m_lastRects(m_words, 0),
+      m_rows(0)
+  {}
+
+  //! Labels the next \p row of the dirty \p rects mask.
+  /*!
+    The pixel statistics of the row should be added with statistics() then, and the row
+    should be finished with finishRow().
+  */
+  void addRow(int row, const uint64_t *rects)
+  {
+    std::fill(m_current.begin(), m_current.end(), s_none);
+    forEachColumn(rects, [&](int column) {
+      uint32_t label = s_none;
+      auto join = [&](uint32_t other) {
+        if (other != s_none) {
+          label = label == s_none ? find(m_parents, other) : unite(label, other);
+        }
+      };
+      if (column > 0) {
+        join(m_current[column - 1]);
+        join(m_previous[column - 1]);
+      }
+      join(m_previous[column]);
+      if (column + 1 < m_columns) {
+        join(m_previous[column + 1]);
+      }
+
+      if (label == s_none) {
+        label = (uint32_t)m_parents.size();
+        m_parents.push_back(label);
+        m_groups.push_back({ column, row, column, row, (uint64_t)row * m_columns + column,
+                             PixelStatistics() });
+      } else {
+        Group &group = m_groups[label];
+        group.left = std::min(group.left, column);
+        group.right = std::max(group.right, column);
+        group.bottom = row;
+      }
+      m_current[column] = label;
+    });
+
+    if (m_rows++ == 0) {
+      m_firstLabels = m_current;
+      std::copy(rects, rects + m_words, m_firstRects.begin());
+    }
+    std::copy(rects, rects + m_words, m_lastRects.begin());
+  }
+
+  //! Returns the pixel statistics of the group of the given dirty rectangle of the current row.
+  PixelStatistics &statistics(int column)
+  {
+    assert(m_current[column] != s_none);
+    return m_groups[find(m_parents, m_current[column])].pixels;
+  }
+
+  //! Finishes the current row.
+  void finishRow()
+  {
+    renumber();
+    std::swap(m_previous, m_current);
+  }
+
+  //! Stitches the open groups of consecutive bands and returns all groups.
+  /*!
+    The groups are sorted in order of their first rectangles.
+  */
+  static std::vector<Group> merge(const std::vector<GroupFinder> &bands)
+  {
+    std::vector<Group> groups;
+    std::vector<Group> open;
+    std::vector<uint32_t> offsets;
+    for (const auto &band : bands) {
+      groups.insert(groups.end(), band.m_complete.begin(), band.m_complete.end());
+      offsets.push_back((uint32_t)open.size());
+      open.insert(open.end(), band.m_groups.begin(), band.m_groups.end());
+    }
+
+    std::vector<uint32_t> parents(open.size());
+    for (uint32_t label = 0; label < parents.size(); ++label) {
+      parents[label] = label;
+    }
+    // The first row of each band is adjacent to the last row of the previous one.
+    for (size_t index = 1; index < bands.size(); ++index) {
+      const GroupFinder &band = bands[index];
+      const GroupFinder &above = bands[index - 1];
+      if (band.m_rows == 0 || above.m_rows == 0) {
+        continue;
+      }
+      band.forEachColumn(band.m_firstRects.data(), [&](int column) {
+        for (int neighbor = std::max(column - 1, 0);
+             neighbor <= std::min(column + 1, band.m_columns - 1); ++neighbor) {
+          if (above.m_lastRects[neighbor / 64] & (uint64_t(1) << (neighbor % 64))) {
+            const uint32_t root1 = find(parents, offsets[index] + band.m_firstLabels[column]);
+            const uint32_t root2 = find(parents, offsets[index - 1] +
+                                                 above.m_previous[neighbor]);
+            parents[std::max(root1, root2)] = std::min(root1, root2);
+          }
         }
+      });
+    }
+
+    for (uint32_t label = 0; label < open.size(); ++label) {
+      const uint32_t root = find(parents, label);
+      if (root != label) {
+        extend(open[root], open[label]);
+      }
+    }
+    for (uint32_t label = 0; label < open.size(); ++label) {
+      if (parents[label] == label) {
+        groups.push_back(open[label]);
       }
     }
 
-    return false;
+    std::sort(groups.begin(), groups.end(), [](const Group &group1, const Group &group2) {
+      return group1.first < group2.first;
+    });
+    return groups;
   }
 
-  const Point &begin() const
+private:
+  static constexpr uint32_t s_none = UINT32_MAX;
+
+  //! Calls the \p function with the index of each dirty rectangle of the \p rects row.
+  template <typename Function>
+  void forEachColumn(const uint64_t *rects, Function function) const
   {
-    return m_begin;
+    for (int w = 0; w < m_words; ++w) {
+      uint64_t bits = rects[w];
+      while (bits) {
+        function(w * 64 + lowestBit(bits));
+        bits &= bits - 1;
+      }
+    }
   }
 
-  const Point &end() const
+  //! Extends the \p group with the \p other one.
+  static void extend(Group &group, const Group &other)
   {
-    return m_end;
+    group.left = std::min(group.left, other.left);
+    group.top = std::min(group.top, other.top);
+    group.right = std::max(group.right, other.right);
+    group.bottom = std::max(group.bottom, other.bottom);
+    group.first = std::min(group.first, other.first);
+    group.pixels.merge(other.pixels);
   }
 
-  bool visited() const
+  //! Merges groups of two labels and returns the root, that is the smaller label.
+  uint32_t unite(uint32_t label1, uint32_t label2)
   {
-    return m_visited;
+    const uint32_t root1 = find(m_parents, label1);
+    const uint32_t root2 = find(m_parents, label2);
+    if (root1 == root2) {
+      return root1;
+    }
+    const uint32_t root = std::min(root1, root2);
+    const uint32_t other = std::max(root1, root2);
+    m_parents[other] = root;
+    extend(m_groups[root], m_groups[other]);
+    return root;
   }
 
-  void setVisited()
+  //! Completes the groups, that don't reach the current row, and renumbers the open ones.
+  void renumber()
   {
-    m_visited = true;
+    // The groups, that reach the current row or touch the first one, remain open.
+    m_ids.assign(m_parents.size(), s_none);
+    forEachColumn(m_lastRects.data(), [&](int column) {
+      m_ids[find(m_parents, m_current[column])] = 0;
+    });
+    forEachColumn(m_firstRects.data(), [&](int column) {
+      m_ids[find(m_parents, m_firstLabels[column])] = 0;
+    });
+
+    size_t open = 0;
+    for (uint32_t label = 0; label < m_parents.size(); ++label) {
+      if (m_parents[label] != label) {
+        continue;
+      }
+      if (m_ids[label] == s_none) {
+        m_complete.push_back(m_groups[label]);
+      } else {
+        m_ids[label] = (uint32_t)open;
+        m_groups[open++] = m_groups[label];
+      }
+    }
+
+    forEachColumn(m_lastRects.data(), [&](int column) {
+      m_current[column] = m_ids[find(m_parents, m_current[column])];
+    });
+    forEachColumn(m_firstRects.data(), [&](int column) {
+      m_firstLabels[column] = m_ids[find(m_parents, m_firstLabels[column])];
+    });
+
+    m_groups.resize(open);
+    m_parents.resize(open);
+    for (uint32_t label = 0; label < open; ++label) {
+      m_parents[label] = label;
+    }
   }
 
-private:
-  Point m_begin;
-  Point m_end;
-  bool m_visited{ false };
+  int m_columns;
+  int m_words;
+  //! The labels of the previous and the current rows.
+  std::vector<uint32_t> m_previous;
+  std::vector<uint32_t> m_current;
+  //! The labels and the dirty rectangles of the first and the last rows.
+  std::vector<uint32_t> m_firstLabels;
+  std::vector<uint64_t> m_firstRects;
+  std::vector<uint64_t> m_lastRects;
+  //! The union-find structure of the open groups and the groups.
+  std::vector<uint32_t> m_parents;
+  std::vector<Group> m_groups;
+  std::vector<uint32_t> m_ids;
+  std::vector<Group> m_complete;
+  int m_rows;
 };
 
-//! Implement a scanning rectangle.
-/*!
-  This is a rectangle that moves through the whole image step by step until it
-  reaches the lower right corner of the image. It moves from left to right and
-  from top to bottom - this is scanning order.
-*/
-class ScanRectangle
+constexpr uint32_t GroupFinder::s_none;
+
+//! Adds the component with the given statistics of its different \p pixels.
+static void addComponent(Components &components, const PixelStatistics &pixels)
 {
-public:
-  ScanRectangle(const Point &origin, int width, int height,
-                const Image &img1, const Image &img2)
-  :
-    m_origin(origin),
-    m_width(width),
-    m_height(height),
-    m_img1(img1),
-    m_img2(img2),
-    m_xLimit(std::min(img1.width() - 1, img2.width() - 1)),
-    m_yLimit(std::min(img1.height() - 1, img2.height() - 1))
-  {}
+  // A group has a rectangle with different pixels, which are assigned to it or its neighbor.
+  assert(pixels.count > 0);
+  const double count = (double)pixels.count;
+  const double meanDelta[3] = { pixels.sumDelta[0] / count, pixels.sumDelta[1] / count,
+                                pixels.sumDelta[2] / count };
+  components.addComponent(pixels.count,
+                          Rect(pixels.left, pixels.top, pixels.right - pixels.left + 1,
+                               pixels.bottom - pixels.top + 1),
+                          pixels.sumX / count, pixels.sumY / count, pixels.maxDelta,
+                          meanDelta);
+}
+
+//! Returns the statistics of the given \p groups.
+static Components components(const std::vector<GroupFinder::Group> &groups)
+{
+  Components components;
+  for (const auto &group : groups) {
+    addComponent(components, group.pixels);
+  }
+  return components;
+}
 
-  int pointCount() const
+//! Removes the \p groups with less than \p minArea different pixels.
+static void removeSmallGroups(std::vector<GroupFinder::Group> &groups, size_t minArea)
+{
+  groups.erase(std::remove_if(groups.begin(), groups.end(),
+                              [&](const GroupFinder::Group &group) {
+                                return group.pixels.count < minArea;
+                              }),
+               groups.end());
+}
+
+//! Returns the number of leading bytes of a pixel in the given \p format to compare.
+static int channelCount(PixelFormat format)
+{
+  switch (format)
   {
+  case PixelFormat::RGBA:
+  case PixelFormat::BGRA:
     return 4;
+  default:
+    return 3;
   }
+}
 
-  Edge edge(int idx) const
+//! Returns the offset of the red channel in a pixel of the given \p format.
+static int redOffset(PixelFormat format)
+{
+  switch (format)
   {
-    assert(idx < pointCount());
-
-    //        0
-    //   +---------+
-    // 3 |         | 1
-    //   |         |
-    //   +---------+
-    //       2
+  case PixelFormat::BGR:
+  case PixelFormat::BGRA:
+  case PixelFormat::BGRX:
+    return 2;
+  default:
+    return 0;
+  }
+}
 
-    switch (idx)
-    {
-    case 0:
-      return Edge(point(0), point(1));
-    case 1:
-      return Edge(point(1), point(2));
-    case 2:
-      return Edge(point(3), point(2));
-    case 3:
-      return Edge(point(0), point(3));
-    default:
-      // This should never happen.
-      assert(false);
-      return Edge(Point(0, 0), Point(0, 0));
+//! Implements comparison of rows of two images of the same size.
+/*!
+  Images of the same pixel format are compared in place. Otherwise rows of both
+  images are converted to RGB first.
+*/
+class RowComparator
+{
+public:
+  RowComparator(const ImageView &image1, const ImageView &image2, const Options &options)
+    :
+      m_image1(image1),
+      m_image2(image2),
+      m_kernels(kernels::active()),
+      m_sameFormat(image1.format() == image2.format()),
+      m_bytesPerPixel(m_sameFormat ? image1.bytesPerPixel() : 3),
+      m_red(m_sameFormat ? redOffset(image1.format()) : 0),
+      m_channels(0),
+      m_tolerant(options.maxChannelDelta() > 0),
+      m_tolerance(m_bytesPerPixel, m_sameFormat ? channelCount(image1.format()) : 3,
+                  options.maxChannelDelta(), options.maxSumDelta())
+  {
+    if (!m_sameFormat) {
+      m_row1.resize((size_t)image1.width() * 3);
+      m_row2.resize((size_t)image2.width() * 3);
+    } else if (m_bytesPerPixel == 4) {
+      // Compare all bytes of a pixel except the unused one.
+      const bool padded = channelCount(image1.format()) == 3;
+      const uint8_t channels[4] = { 0xFF, 0xFF, 0xFF, uint8_t(padded ? 0 : 0xFF) };
+      memcpy(&m_channels, channels, sizeof(m_channels));
     }
   }
 
-  Point point(int idx) const
+  //! Returns the width of the compared images.
+  int width() const
+  {
+    return m_image1.width();
+  }
+
+  //! Compares the given \p row and writes the difference bits to the \p mask.
+  /*!
+    \return true if at least one pixel differs.
+  */
+  bool compare(int row, uint64_t *mask)
   {
-    assert(idx < pointCount());
+    return compare(row, 0, m_image1.width(), mask);
+  }
 
-    // 0 +---------+ 1
-    //   |         |
-    //   |         |
-    // 3 +---------+ 2
+  //! Compares \p count pixels of the given \p row starting from the column \p x.
+  /*!
+    The \p x must be a multiple of 64, so the difference bits are written to the
+    \p mask starting from the word <tt>x / 64</tt>.
 
-    switch (idx)
-    {
-    case 0:
-      return m_origin;
-    case 1:
-      return Point(std::min(m_origin.x() + m_width, m_xLimit), m_origin.y());
-    case 2:
-      return Point(std::min(m_origin.x() + m_width, m_xLimit),
-                   std::min(m_origin.y() + m_height, m_yLimit));
-    case 3:
-      return Point(m_origin.x(),
-                   std::min(m_origin.y() + m_height, m_yLimit));
-    default:
-      break;
+    \return true if at least one pixel differs.
+  */
+  bool compare(int row, int x, int count, uint64_t *mask)
+  {
+    assert(x % 64 == 0);
+
+    const uint8_t *row1;
+    const uint8_t *row2;
+    rows(row, row1, row2);
+    row1 += (size_t)x * m_bytesPerPixel;
+    row2 += (size_t)x * m_bytesPerPixel;
+    mask += x / 64;
+
+    if (m_tolerant) {
+      return m_kernels.diffRowTolerant(row1, row2, count, m_tolerance, mask);
+    } else if (m_bytesPerPixel == 4) {
+      return m_kernels.diffRow32(row1, row2, count, m_channels, mask);
     }
-    return Point();
+    return m_kernels.diffRow(row1, row2, count, mask);
   }
 
-  //! Tests whether this scan rectangle contains a failed pixel.
-  bool test() const
+  //! Adds the different pixels of the given \p row from \p begin to \p end to the \p statistics.
+  /*!
+    The \p mask is the row of the difference mask. The channel deltas are read from
+    the same pixel data, that the row is compared in.
+  */
+  void addDifferences(int row, int begin, int end, const uint64_t *mask,
+                      PixelStatistics &statistics)
   {
-    const int cMax = std::min(m_origin.x() + m_width, m_xLimit);
-    const int rMax = std::min(m_origin.y() + m_height, m_yLimit);
-    for (int c = m_origin.x(); c <= cMax; c++) {
-      for (int r = m_origin.y(); r <= rMax; r++) {
-        Color color1 = m_img1.pixel(r, c);
-        Color color2 = m_img2.pixel(r, c);
-
-        if (color1 != color2) {
-          // Exist as soon as the first failure detected.
-          return false;
+    const uint8_t *row1;
+    const uint8_t *row2;
+    rows(row, row1, row2);
+    const int channels[3] = { m_red, 1, 2 - m_red };
+
+    PixelStatistics pixels;
+    for (int w = begin / 64; w * 64 < end; ++w) {
+      uint64_t bits = mask[w];
+      if (w == begin / 64) {
+        bits &= ~uint64_t(0) << (begin % 64);
+      }
+      if ((w + 1) * 64 > end) {
+        bits &= (uint64_t(1) << (end % 64)) - 1;
+      }
+      if (bits == ~uint64_t(0)) {
+        // All pixels of the word differ, which is common for massive differences.
+        const int x = w * 64;
+        if (pixels.count == 0) {
+          pixels.left = x;
+        }
+        pixels.count += 64;
+        pixels.right = x + 63;
+        pixels.sumX += (uint64_t)x * 64 + 63 * 32;
+        const size_t offset = (size_t)x * m_bytesPerPixel;
+        if (m_bytesPerPixel == 4) {
+          addDeltas<4>(row1 + offset, row2 + offset, channels, pixels);
+        } else {
+          addDeltas<3>(row1 + offset, row2 + offset, channels, pixels);
+        }
+        continue;
+      }
+      while (bits) {
+        const int x = w * 64 + lowestBit(bits);
+        bits &= bits - 1;
+        if (pixels.count++ == 0) {
+          pixels.left = x;
+        }
+        pixels.right = x;
+        pixels.sumX += x;
+
+        const uint8_t *pixel1 = row1 + (size_t)x * m_bytesPerPixel;
+        const uint8_t *pixel2 = row2 + (size_t)x * m_bytesPerPixel;
+        for (int channel = 0; channel < 3; ++channel) {
+          const uint8_t delta = PixelStatistics::delta(pixel1[channels[channel]],
+                                                       pixel2[channels[channel]]);
+          pixels.maxDelta[channel] = std::max(pixels.maxDelta[channel], delta);
+          pixels.sumDelta[channel] += delta;
         }
       }
     }
-    return true;
-  }
 
-  //! Indicates whether the rectangle reached the end of scanning.
-  bool atEnd() const
-  {
-    return m_origin.x() == 0 && m_origin.y() >= m_yLimit;
+    if (pixels.count > 0) {
+      pixels.top = row;
+      pixels.bottom = row;
+      pixels.sumY = (uint64_t)row * pixels.count;
+      statistics.merge(pixels);
+    }
   }
 
-  //! A pre-increment operator.
-  ScanRectangle &operator++()
+private:
+  RowComparator &operator=(const RowComparator &) = delete;
+
+  //! Adds the channel deltas of 64 consecutive pixels to the \p pixels statistics.
+  template <int BytesPerPixel>
+  static void addDeltas(const uint8_t *row1, const uint8_t *row2, const int channels[3],
+                        PixelStatistics &pixels)
   {
-    if (!atEnd()) {
-      if (m_origin.x() < m_xLimit - m_width) {
-        m_origin.x() += m_width;
-      } else if (m_origin.y() < m_yLimit) {
-        // Move to the next row and left most position.
-        m_origin.x() = 0;
-        m_origin.y() += m_height;
+    // The sums of 64 deltas fit in 32 bits, and the loops are vectorized.
+    for (int channel = 0; channel < 3; ++channel) {
+      const uint8_t *values1 = row1 + channels[channel];
+      const uint8_t *values2 = row2 + channels[channel];
+      uint8_t maximum = pixels.maxDelta[channel];
+      uint32_t sum = 0;
+      for (int i = 0; i < 64 * BytesPerPixel; i += BytesPerPixel) {
+        const uint8_t delta = PixelStatistics::delta(values1[i], values2[i]);
+        maximum = std::max(maximum, delta);
+        sum += delta;
       }
+      pixels.maxDelta[channel] = maximum;
+      pixels.sumDelta[channel] += sum;
     }
-
-    return *this;
   }
 
-  const Point &origin() const
+  //! Returns the pixel data of the given \p row of both images to compare.
+  /*!
+    The rows of images of different formats are converted once per row.
+  */
+  void rows(int row, const uint8_t *&row1, const uint8_t *&row2)
   {
-    return m_origin;
+    if (m_sameFormat) {
+      row1 = m_image1.scanline(row);
+      row2 = m_image2.scanline(row);
+      return;
+    }
+    if (m_convertedRow != row) {
+      m_image1.convertRow(row, m_row1.data());
+      m_image2.convertRow(row, m_row2.data());
+      m_convertedRow = row;
+    }
+    row1 = m_row1.data();
+    row2 = m_row2.data();
   }
 
-private:
-  ScanRectangle& operator=(const ScanRectangle&) = delete;
-
-  Point m_origin;
-  int m_width;
-  int m_height;
-
-  const Image &m_img1;
-  const Image &m_img2;
-
-  int m_xLimit;
-  int m_yLimit;
+  const ImageView &m_image1;
+  const ImageView &m_image2;
+  const kernels::KernelSet &m_kernels;
+  bool m_sameFormat;
+  int m_bytesPerPixel;
+  int m_red;
+  uint32_t m_channels;
+  bool m_tolerant;
+  kernels::Tolerance m_tolerance;
+  std::vector<uint8_t> m_row1;
+  std::vector<uint8_t> m_row2;
+  int m_convertedRow{ -1 };
 };
 
-class Contours
+//! Compares the given \p row of two images and writes the difference bits to the \p mask.
+/*!
+  If the \p tiles mask is provided, only the tiles of the TileIndex grid, that have
+  their bits set, are compared, and the mask words of other tiles are left intact.
+
+  \return true if at least one pixel differs.
+*/
+static bool compareRow(RowComparator &comparator, int row, const BitMask *tiles,
+                       uint64_t *mask)
 {
-public:
-  using Contour = std::vector<Edge>;
+  if (!tiles) {
+    return comparator.compare(row, mask);
+  }
 
-  void addRect(const ScanRectangle &rect)
-  {
-    for (int i = 0; i < rect.pointCount(); ++i) {
-      const Edge &edge = rect.edge(i);
-      auto result = m_uniqueEdges.emplace(edge);
-      if (!result.second) {
-        m_uniqueEdges.erase(result.first);
-      }
+  const int width = comparator.width();
+  bool different = false;
+  // A tile is 64 pixels wide, i.e. it corresponds to a mask word.
+  const uint64_t *words = tiles->row(row / TileIndex::tileSize());
+  for (int w = 0; w < tiles->wordsPerRow(); ++w) {
+    uint64_t bits = words[w];
+    while (bits) {
+      const int x = (w * 64 + lowestBit(bits)) * TileIndex::tileSize();
+      bits &= bits - 1;
+      different |= comparator.compare(row, x, std::min(TileIndex::tileSize(), width - x), mask);
     }
   }
+  return different;
+}
 
-  std::vector<Contour> makeContours()
-  {
-    // Find connected components in an undirected graph by using depth-first search
-    // algorithm.
-    std::vector<Contour> contours;
+//! Returns the number of set bits in the \p count words of the \p mask.
+static size_t countBits(const uint64_t *mask, int count)
+{
+  size_t bits = 0;
+  for (int w = 0; w < count; ++w) {
+    bits += bitCount(mask[w]);
+  }
+  return bits;
+}
 
-    std::vector<Edge> edges(m_uniqueEdges.begin(), m_uniqueEdges.end());
+//! Checks whether two images can be compared byte by byte.
+/*!
+  It's not the case for images of different pixel formats or with unused bytes in pixels.
+*/
+static bool bytewiseComparable(const ImageView &image1, const ImageView &image2)
+{
+  const PixelFormat format = image1.format();
+  return format == image2.format() && image1.bytesPerPixel() == channelCount(format);
+}
 
-    for (auto &e : edges) {
-      if (!e.visited()) {
-        contours.emplace_back();
-        // Find all reachable edges from edge
-        dfs(e, edges, contours.back());
-      }
-    }
-    return contours;
-  }
+//! Checks whether two images of the same size have identical pixel data.
+/*!
+  It's a memory bandwidth bound comparison of the whole image buffers, that is
+  much cheaper than building the difference mask. The buffers are split into bands
+  compared in parallel, and all bands stop as soon as any of them finds a difference.
 
-private:
-  /// Implements the DFS algorithm
-  void dfs(Edge &edge, std::vector<Edge> &edges, std::vector<Edge> &contour)
-  {
-    std::stack<Edge *> stack;
-    stack.push(&edge);
+  Images that aren't bytewise comparable can't be compared this way, so the function
+  returns false for them.
+*/
+static bool identical(const ImageView &image1, const ImageView &image2, int threads)
+{
+  // The number of bytes compared before checking whether other bands found a difference.
+  static constexpr size_t s_chunkSize = 1 << 20;
 
-    while (!stack.empty()) {
-      auto e = stack.top();
-      stack.pop();
+  if (!bytewiseComparable(image1, image2)) {
+    return false;
+  }
 
-      if (e->visited()) {
-        continue;
+  const auto &kernelSet = kernels::active();
+  const size_t rowSize = (size_t)image1.width() * image1.bytesPerPixel();
+  // Rows without gaps between them are compared in chunks, otherwise one by one.
+  const bool contiguous = image1.stride() == (int)rowSize && image2.stride() == (int)rowSize;
+  const int chunkRows = contiguous ? (int)std::max<size_t>(1, s_chunkSize / rowSize) : 1;
+
+  std::atomic<bool> different{ false };
+  forEachBand(image1.height(), threads, [&](int, int begin, int end) {
+    for (int row = begin; row < end && !different; row += chunkRows) {
+      const int rows = std::min(chunkRows, end - row);
+      if (!kernelSet.equal(image1.scanline(row), image2.scanline(row), rowSize * rows)) {
+        different = true;
       }
+    }
+  });
 
-      // Mark the current edge as visited and save it
-      e->setVisited();
-      contour.emplace_back(*e);
-
-      auto end = e->end();
-      auto begin = e->begin();
-
-      // Find all edges adjacent to this edge
-      for (auto &currentEdge : edges) {
-        if (!currentEdge.visited()) {
-          auto cb = currentEdge.begin();
-          auto ce = currentEdge.end();
-          if (end   == cb || end   == ce ||
-              begin == cb || begin == ce)
-          {
-            stack.push(&currentEdge);
-          } else if (begin.minDistance(cb) > s_maxRectDimentinon &&
-                     begin.minDistance(ce) > s_maxRectDimentinon &&
-                     end.minDistance(cb)   > s_maxRectDimentinon &&
-                     end.minDistance(ce)   > s_maxRectDimentinon) {
-            // The edges are too far from each other. Doesn't make sense to
-            // continue. This logic is valid, because the edges are sorted.
-            break;
-          }
-        }
+  return !different;
+}
+
+//! Checks whether any row of two images of the same size differs.
+/*!
+  The images are compared row by row in parallel bands, and all bands stop as soon
+  as any of them finds a difference.
+*/
+static bool anyRowDiffers(const ImageView &image1, const ImageView &image2,
+                          const Options &options, int threads)
+{
+  std::atomic<bool> different{ false };
+  forEachBand(image1.height(), threads, [&](int, int begin, int end) {
+    RowComparator comparator(image1, image2, options);
+    std::vector<uint64_t> mask((image1.width() + 63) / 64);
+    for (int row = begin; row < end && !different; ++row) {
+      if (comparator.compare(row, mask.data())) {
+        different = true;
       }
     }
-  }
+  });
 
-  std::set<Edge> m_uniqueEdges;
-};
+  return different;
+}
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -332,7 +1814,8 @@ Result::Result(Result::Status diff, Result::Error error, const std::string &erro
     m_status(diff),
     m_error(error),
     m_errorMessage(errorMessage),
-    m_contourCount(0)
+    m_contourCount(0),
+    m_truncated(false)
 {}
 
 Result::Status Result::status() const
@@ -355,9 +1838,14 @@ const Image &Result::resultImage() const
   return m_result;
 }
 
-void Result::setResultImage(const Image &image)
+Image Result::takeResultImage()
+{
+  return std::move(m_result);
+}
+
+void Result::setResultImage(Image image)
 {
-  m_result = image;
+  m_result = std::move(image);
 }
 
 size_t Result::contourCount() const
@@ -370,10 +1858,301 @@ void Result::setContourCount(size_t count)
   m_contourCount = count;
 }
 
+const Contours &Result::contours() const
+{
+  return m_contours;
+}
+
+void Result::setContours(Contours contours)
+{
+  m_contours = std::move(contours);
+}
+
+const std::vector<Rect> &Result::boundingBoxes() const
+{
+  return m_boundingBoxes;
+}
+
+void Result::setBoundingBoxes(std::vector<Rect> boxes)
+{
+  m_boundingBoxes = std::move(boxes);
+}
+
+const Components &Result::components() const
+{
+  return m_components;
+}
+
+void Result::setComponents(Components components)
+{
+  m_components = std::move(components);
+}
+
+const BitMask &Result::differenceMask() const
+{
+  return m_differenceMask;
+}
+
+void Result::setDifferenceMask(BitMask mask)
+{
+  m_differenceMask = std::move(mask);
+}
+
+bool Result::isTruncated() const
+{
+  return m_truncated;
+}
+
+void Result::setTruncated(bool truncated)
+{
+  m_truncated = truncated;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 Result Comparator::compare(const Image &image1, const Image &image2,
                            const Color &highlightColor)
+{
+  Options options;
+  options.setHighlightColor(highlightColor);
+  return compare(image1, image2, options);
+}
+
+//! Adds the different pixels of the pixel row \p y to the statistics of their groups.
+/*!
+  The \p mask is the row of the difference mask, and the \p rects is the row of
+  rectangles, that the pixel row is assigned to. It should be the current row of the
+  \p finder. The pixels of each run of rectangles are added at once.
+*/
+static void addPixels(GroupFinder &finder, const ScanGrid &grid, RowComparator &comparator,
+                      int y, const uint64_t *mask, const uint64_t *rects)
+{
+  forEachRun(rects, (grid.columns() + 63) / 64, [&](int begin, int end) {
+    comparator.addDifferences(y, grid.assignedPixelColumns(begin).first,
+                              grid.assignedPixelColumns(end - 1).second + 1, mask,
+                              finder.statistics(begin));
+  });
+}
+
+//! Returns the statistics of the different pixels of the groups of the \p contours.
+/*!
+  The grid rows are split into bands. The pixels are added run by run, and the deltas
+  are read from the compared rows. A band adds the pixels of the groups, that begin in
+  it, to their statistics in place, as no other band begins them. The statistics of
+  the groups, that begin above the band and reach its first row, are accumulated
+  separately and merged afterwards.
+*/
+static std::vector<PixelStatistics> groupStatistics(const ContourFinder &contours,
+                                                    const ScanGrid &grid, const BitMask &diff,
+                                                    const ImageView &image1,
+                                                    const ImageView &image2,
+                                                    const Options &options, int threads)
+{
+  struct Run
+  {
+    int begin;
+    int end;
+    PixelStatistics *statistics;
+  };
+
+  std::vector<PixelStatistics> statistics(contours.groupCount());
+  using Crossing = std::pair<uint32_t, PixelStatistics>;
+  std::vector<std::vector<Crossing>> crossing(bandCount(grid.rows(), threads));
+  forEachBand(grid.rows(), threads, [&](int band, int begin, int end) {
+    if (begin == end) {
+      return;
+    }
+
+    const uint32_t first = contours.firstGroup(begin);
+    std::vector<Crossing> &above = crossing[band];
+    contours.forEachRun(begin, [&](int, int, uint32_t group) {
+      if (group < first) {
+        above.emplace_back(group, PixelStatistics());
+      }
+    });
+    auto less = [](const Crossing &crossing1, const Crossing &crossing2) {
+      return crossing1.first < crossing2.first;
+    };
+    std::sort(above.begin(), above.end(), less);
+    above.erase(std::unique(above.begin(), above.end(),
+                            [](const Crossing &crossing1, const Crossing &crossing2) {
+                              return crossing1.first == crossing2.first;
+                            }),
+                above.end());
+
+    RowComparator comparator(image1, image2, options);
+    std::vector<Run> runs;
+    for (int row = begin; row < end; ++row) {
+      runs.clear();
+      contours.forEachRun(row, [&](int columnBegin, int columnEnd, uint32_t group) {
+        PixelStatistics *pixels = &statistics[group];
+        if (group < first) {
+          pixels = &std::lower_bound(above.begin(), above.end(),
+                                     Crossing(group, PixelStatistics()), less)->second;
+        }
+        runs.push_back({ grid.assignedPixelColumns(columnBegin).first,
+                         grid.assignedPixelColumns(columnEnd - 1).second + 1, pixels });
+      });
+
+      const auto pixelRows = grid.assignedPixelRows(row);
+      for (int y = pixelRows.first; y <= pixelRows.second; ++y) {
+        for (const Run &run : runs) {
+          comparator.addDifferences(y, run.begin, run.end, diff.row(y), *run.statistics);
+        }
+      }
+    }
+  });
+
+  for (const auto &band : crossing) {
+    for (const Crossing &group : band) {
+      statistics[group.first].merge(group.second);
+    }
+  }
+  return statistics;
+}
+
+//! Compares two images in a single pass and returns the bounding boxes of the differences.
+/*!
+  The grid rows are split into bands, and each band compares the pixel rows covered
+  by its rectangles one by one, keeping only the difference bits of the rectangle
+  rows within the merge radius from the current one. The pixel rows on the band
+  borders are compared by both bands.
+*/
+static Result findBoundingBoxes(const ImageView &image1, const ImageView &image2,
+                                const Options &options, const BitMask *tiles, int threads)
+{
+  const ScanGrid grid(image1.width(), image1.height(), options.blockWidth(),
+                      options.blockHeight());
+  const int words = (image1.width() + 63) / 64;
+  const size_t maxPixels = options.maxDifferentPixels();
+  std::atomic<size_t> differentPixels{ 0 };
+
+  std::vector<GroupFinder> bands(bandCount(grid.rows(), threads),
+                                 GroupFinder(grid.columns()));
+  forEachBand(grid.rows(), threads, [&](int band, int begin, int end) {
+    if (begin == end) {
+      return;
+    }
+
+    const auto &kernelSet = kernels::active();
+    RowComparator comparator(image1, image2, options);
+    std::vector<uint64_t> diff(words);
+    std::vector<uint64_t> merged(words);
+    const int rectWords = (grid.columns() + 63) / 64;
+    std::vector<uint64_t> rects(rectWords);
+
+    // The dirty rectangles of the rows within the merge radius from the current one,
+    // grown horizontally. The band needs the rows within the radius from its borders.
+    const int radius = mergeRadius(options, grid.columns(), grid.rows());
+    std::vector<uint64_t> window((2 * radius + 1) * rectWords);
+    auto windowRow = [&](int row) {
+      return window.data() + (row % (2 * radius + 1)) * rectWords;
+    };
+    const int first = std::max(begin - radius, 0);
+
+    // The different pixels of the rows of rectangles in the window, kept for statistics.
+    const int rowsPerRect = options.blockHeight() + 1;
+    std::vector<uint64_t> pixels((2 * radius + 1) * rowsPerRect * words);
+    auto pixelRow = [&](int row, int y) {
+      return pixels.data() +
+             ((row % (2 * radius + 1)) * rowsPerRect + y - grid.pixelRows(row).first) * words;
+    };
+
+    // The different pixels are counted only by the band, that rectangles row belongs to.
+    auto compare = [&](int row, bool count) {
+      if (tiles) {
+        std::fill(diff.begin(), diff.end(), 0);
+      }
+      if (compareRow(comparator, row, tiles, diff.data()) && count && maxPixels > 0) {
+        differentPixels += countBits(diff.data(), words);
+      }
+    };
+
+    compare(grid.pixelRows(first).first, begin == 0);
+    int next = first;
+    for (int row = begin; row < end; ++row) {
+      for (const int last = std::min(row + radius, grid.rows() - 1); next <= last; ++next) {
+        if (maxPixels > 0 && differentPixels > maxPixels) {
+          // This or other bands exceeded the limit.
+          return;
+        }
+
+        // The first pixel row of these rectangles is the last one of the previous row.
+        merged = diff;
+        const auto pixelRows = grid.pixelRows(next);
+        std::copy(diff.begin(), diff.end(), pixelRow(next, pixelRows.first));
+        for (int y = pixelRows.first + 1; y <= pixelRows.second; ++y) {
+          compare(y, next >= begin && next < end);
+          kernelSet.mergeRow(merged.data(), diff.data(), words);
+          std::copy(diff.begin(), diff.end(), pixelRow(next, y));
+        }
+
+        uint64_t *marked = windowRow(next);
+        std::fill(marked, marked + rectWords, 0);
+        grid.mark(merged.data(), words, marked);
+        if (radius > 0) {
+          dilateRow(marked, grid.columns(), radius);
+        }
+      }
+
+      std::fill(rects.begin(), rects.end(), 0);
+      for (int source = std::max(row - radius, 0); source < next; ++source) {
+        kernelSet.mergeRow(rects.data(), windowRow(source), rectWords);
+      }
+      GroupFinder &finder = bands[band];
+      finder.addRow(row, rects.data());
+      const auto pixelRows = grid.assignedPixelRows(row);
+      for (int y = pixelRows.first; y <= pixelRows.second; ++y) {
+        addPixels(finder, grid, comparator, y, pixelRow(row, y), rects.data());
+      }
+      finder.finishRow();
+    }
+  });
+
+  if (maxPixels > 0 && differentPixels > maxPixels) {
+    Result result(Result::Status::Different, Result::Error::NoError);
+    result.setTruncated(true);
+    return result;
+  }
+
+  auto groups = GroupFinder::merge(bands);
+  if (options.minComponentArea() > 0) {
+    removeSmallGroups(groups, options.minComponentArea());
+  }
+  if (groups.empty()) {
+    return Result(Result::Status::Identical, Result::Error::NoError);
+  }
+
+  const size_t maxContours = options.maxContours();
+  const bool truncated = maxContours > 0 && groups.size() > maxContours;
+  std::vector<Rect> rects;
+  const size_t count = truncated ? maxContours : groups.size();
+  rects.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    const GroupFinder::Group &box = groups[i];
+    // The box covers the outline, that goes through the corners of the rectangles.
+    const Point topLeft = grid.corner(box.left, box.top);
+    const Point bottomRight = grid.corner(box.right + 1, box.bottom + 1);
+    rects.emplace_back(topLeft.x(), topLeft.y(), bottomRight.x() - topLeft.x() + 1,
+                       bottomRight.y() - topLeft.y() + 1);
+  }
+
+  Result result(Result::Status::Different, Result::Error::NoError);
+  result.setBoundingBoxes(std::move(rects));
+  result.setComponents(components(groups));
+  result.setTruncated(truncated);
+  return result;
+}
+
+//! Compares two images and returns comparison result.
+/*!
+  If the \p tiles mask is provided, only the tiles of the TileIndex grid, that
+  have their bits set, are compared. If the \p base image is provided, the \p image2
+  is its view, and the result image shares the pixel data with it.
+*/
+static Result compareImages(const ImageView &image1, const ImageView &image2,
+                            const Options &options, const BitMask *tiles,
+                            const Image *base)
 {
   if (image1.isNull() || image2.isNull()) {
     return Result(Result::Status::Unknown, Result::Error::InvalidImage,
@@ -385,38 +2164,175 @@ Result Comparator::compare(const Image &image1, const Image &image2,
                   "Images have different dimensions");
   }
 
-  Point origin{ 0, 0 }; // Start scanning from the upper left corner.
-  ScanRectangle sr(origin, s_scanRectWidth, s_scanRectHeight, image1, image2);
-  Contours contours;
-  while (!sr.atEnd()) {
-    if (!sr.test()) {
-      contours.addRect(sr);
+  const int width = image1.width();
+  const int height = image1.height();
+  const int threads = effectiveThreadCount(options.threadCount());
+
+  // Most of the comparisons find identical images, so it's worth checking this first.
+  // The tile hashes already tell that the images differ.
+  if (!tiles && identical(image1, image2, threads)) {
+    return Result(Result::Status::Identical, Result::Error::NoError);
+  }
+
+  if (options.boundingBoxesOnly()) {
+    return findBoundingBoxes(image1, image2, options, tiles, threads);
+  }
+
+  BitMask diff(width, height);
+  const size_t maxPixels = options.maxDifferentPixels();
+  std::atomic<size_t> differentPixels{ 0 };
+  forEachBand(height, threads, [&](int, int begin, int end) {
+    RowComparator comparator(image1, image2, options);
+    for (int row = begin; row < end; ++row) {
+      if (maxPixels > 0 && differentPixels > maxPixels) {
+        // This or other bands exceeded the limit.
+        break;
+      }
+
+      uint64_t *mask = diff.row(row);
+      if (compareRow(comparator, row, tiles, mask) && maxPixels > 0) {
+        differentPixels += countBits(mask, diff.wordsPerRow());
+      }
     }
-    ++sr;
+  });
+
+  if (maxPixels > 0 && differentPixels > maxPixels) {
+    Result result(Result::Status::Different, Result::Error::NoError);
+    result.setDifferenceMask(std::move(diff));
+    result.setTruncated(true);
+    return result;
   }
 
-  const auto &cont = contours.makeContours();
+  ScanGrid grid(width, height, options.blockWidth(), options.blockHeight());
+  BitMask rects(grid.columns(), grid.rows());
+  forEachBand(grid.rows(), threads, [&](int, int begin, int end) {
+    grid.scan(diff, begin, end, rects);
+  });
 
-  if (cont.size() > 0) {
-    Image output = image2;
+  const int radius = mergeRadius(options, grid.columns(), grid.rows());
+  if (radius > 0) {
+    dilate(rects, radius, threads);
+  }
 
-    for (size_t i = 0; i < cont.size(); ++i) {
-      const auto &contour = cont[i];
-      for (const auto &edge : contour) {
-        // Draw outline for each edge.
-        output.drawLine(edge.begin(), edge.end(), highlightColor);
+  ContourFinder contours(grid, rects);
+  contours.findEdges(threads);
+  size_t count = contours.label(threads);
+
+  Components components;
+  if (count > 0) {
+    auto statistics = groupStatistics(contours, grid, diff, image1, image2, options, threads);
+    // The contours of small groups are moved after the others, so they aren't outlined.
+    const size_t minArea = options.minComponentArea();
+    std::vector<bool> kept(statistics.size());
+    for (size_t group = 0; group < statistics.size(); ++group) {
+      kept[group] = statistics[group].count >= minArea;
+      if (kept[group]) {
+        addComponent(components, statistics[group]);
       }
     }
+    if (minArea > 0) {
+      count = contours.keepGroups(kept, threads);
+    }
+  }
+
+  if (count > 0) {
+    // Only the contours within the limit are outlined.
+    const size_t maxContours = options.maxContours();
+    const bool truncated = maxContours > 0 && count > maxContours;
+    const size_t outlined = truncated ? maxContours : count;
+
+    // Only the bands of rows, that the outlines are drawn in, are copied from the base.
+    Image output = base ? Image(*base) : Image(image2);
+    contours.forEachEdge([&](const Point &begin, const Point &end, size_t contour) {
+      if (contour < outlined) {
+        output.drawLine(begin, end, options.highlightColor());
+      }
+    });
 
     Result result(Result::Status::Different, Result::Error::NoError);
-    result.setResultImage(output);
-    result.setContourCount(cont.size());
+    result.setResultImage(std::move(output));
+    result.setContourCount(outlined);
+    Contours polygons = contours.polygons(outlined);
+    polygons.simplify(options.simplificationTolerance());
+    result.setContours(std::move(polygons));
+    result.setComponents(std::move(components));
+    result.setDifferenceMask(std::move(diff));
+    result.setTruncated(truncated);
     return result;
   }
 
   return Result(Result::Status::Identical, Result::Error::NoError);
 }
 
+Result Comparator::compare(const Image &image1, const Image &image2, const Options &options)
+{
+  const TileIndex &index1 = image1.tileIndex();
+  const TileIndex &index2 = image2.tileIndex();
+  if (!index1.isNull() && !index2.isNull() && index1.isCompatible(index2)) {
+    const BitMask tiles = index1.difference(index2);
+    if (tiles.count() == 0) {
+      return Result(Result::Status::Identical, Result::Error::NoError);
+    }
+    return compareImages(image1.view(), image2.view(), options, &tiles, &image2);
+  }
+
+  return compareImages(image1.view(), image2.view(), options, nullptr, &image2);
+}
+
+Result Comparator::compare(const ImageView &image1, const ImageView &image2,
+                           const Options &options)
+{
+  return compareImages(image1, image2, options, nullptr, nullptr);
+}
+
+bool Comparator::isIdentical(const std::string &file1, const std::string &file2)
+{
+  return isIdentical(Image(file1), Image(file2));
+}
+
+bool Comparator::isIdentical(const Image &image1, const Image &image2, const Options &options)
+{
+  const TileIndex &index1 = image1.tileIndex();
+  const TileIndex &index2 = image2.tileIndex();
+  if (!index1.isNull() && !index2.isNull() && index1.isCompatible(index2)) {
+    // Different hashes mean different pixels, but they may be within the tolerance.
+    if (index1.difference(index2).count() == 0) {
+      return true;
+    } else if (options.maxChannelDelta() == 0) {
+      return false;
+    }
+  }
+
+  return isIdentical(image1.view(), image2.view(), options);
+}
+
+bool Comparator::isIdentical(const ImageView &image1, const ImageView &image2,
+                             const Options &options)
+{
+  if (image1.isNull() || image2.isNull() ||
+      image1.width() != image2.width() || image1.height() != image2.height()) {
+    return false;
+  }
+
+  const int threads = effectiveThreadCount(options.threadCount());
+  if (identical(image1, image2, threads)) {
+    return true;
+  }
+
+  // The exact comparison of the whole buffers is final, unless it isn't applicable to
+  // the images or the differences within the tolerance should be ignored.
+  if (bytewiseComparable(image1, image2) && options.maxChannelDelta() == 0) {
+    return false;
+  }
+
+  return !anyRowDiffers(image1, image2, options, threads);
+}
+
+std::string Comparator::kernelName()
+{
+  return kernels::active().name;
+}
+
 Result Comparator::compare(const std::string &file1, const std::string &file2)
 {
   Image img1(file1);
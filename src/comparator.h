@@ -26,8 +26,15 @@
 #define _COMPARATOR_H_
 
 #include <string>
+#include <vector>
+#include "bitmask.h"
+#include "components.h"
+#include "contours.h"
 #include "export.h"
 #include "image.h"
+#include "imageview.h"
+#include "options.h"
+#include "rect.h"
 
 namespace nkar
 {
@@ -54,6 +61,22 @@ public:
   //! Constructs a result object with the given \p status \p error and \p errorMessage if any.
   Result(Status status, Error error, const std::string &errorMessage = std::string());
 
+  //! Copy constructor
+  Result(const Result &other) = default;
+
+  //! Move constructor
+  /*!
+    Takes over the result image, the contours and the other data of the \p other
+    result without copying them.
+  */
+  Result(Result &&other) = default;
+
+  //! The assignment operator.
+  Result &operator = (const Result &other) = default;
+
+  //! The move assignment operator.
+  Result &operator = (Result &&other) = default;
+
   //! Returns the comparison status.
   Status status() const;
 
@@ -66,8 +89,15 @@ public:
   //! Returns the resulting image with highlighted differences.
   const Image &resultImage() const;
 
+  //! Takes the ownership of the result image and leaves the result without it.
+  /*!
+    The pixel data is moved out of the result without copying, so the caller can keep
+    the image after the result is destroyed.
+  */
+  Image takeResultImage();
+
   //! Sets the result image.
-  void setResultImage(const Image &image);
+  void setResultImage(Image image);
 
   //! Returns the number of difference contours.
   size_t contourCount() const;
@@ -75,12 +105,77 @@ public:
   //! Set the number of difference contours.
   void setContourCount(size_t count);
 
+  //! Returns the outlines of the difference contours as polygons.
+  /*!
+    The polygons go through the corners of the outlines drawn on the result image.
+    The result has no polygons if the images are identical or the comparison failed.
+  */
+  const Contours &contours() const;
+
+  //! Sets the outlines of the difference contours.
+  void setContours(Contours contours);
+
+  //! Returns the bounding boxes of the differences found in the bounding box mode.
+  /*!
+    Each box encloses a group of different blocks, that touch each other at least
+    by corners, together with the outline, that would be drawn around it. The boxes
+    are ordered by the first block of their groups in scanning order. The result has
+    no boxes unless the comparison runs in the bounding box mode, and then it has
+    neither contours nor the result image, and the contour count is zero.
+
+    \sa Options::setBoundingBoxesOnly()
+  */
+  const std::vector<Rect> &boundingBoxes() const;
+
+  //! Sets the bounding boxes of the differences.
+  void setBoundingBoxes(std::vector<Rect> boxes);
+
+  //! Returns the statistics of the connected difference components.
+  /*!
+    A component is a group of different blocks, that touch each other at least by
+    corners. The i-th component corresponds to the i-th outer polygon of the contours,
+    or to the i-th bounding box in the bounding box mode. The statistics cover all
+    components, even if the contours or the boxes are truncated by the contour limit.
+
+    \sa Options::setMaxContours()
+  */
+  const Components &components() const;
+
+  //! Sets the statistics of the difference components.
+  void setComponents(Components components);
+
+  //! Returns the pixel difference mask.
+  /*!
+    The mask has the images dimensions and one bit per pixel, that is set if the
+    pixel differs according to the comparison options. It's a null mask if the
+    images are identical or the comparison failed. The mask of a truncated result
+    contains only the differences found before the comparison stopped.
+  */
+  const BitMask &differenceMask() const;
+
+  //! Sets the pixel difference mask.
+  void setDifferenceMask(BitMask mask);
+
+  //! Returns true if the comparison stopped because the difference limits were exceeded.
+  /*!
+    \sa Options::setMaxDifferentPixels(), Options::setMaxContours()
+  */
+  bool isTruncated() const;
+
+  //! Sets whether the comparison stopped because the difference limits were exceeded.
+  void setTruncated(bool truncated);
+
 private:
   Status m_status;
   Error m_error;
   std::string m_errorMessage;
   Image m_result;
+  Contours m_contours;
+  std::vector<Rect> m_boundingBoxes;
+  Components m_components;
+  BitMask m_differenceMask;
   size_t m_contourCount;
+  bool m_truncated;
 };
 
 //! The class performs comparison of two images and outputs result of comparison.
@@ -98,6 +193,58 @@ public:
   */
   static Result compare(const Image &image1, const Image &image2,
                         const Color &highlightColor = {255, 0, 0});
+
+  //! Compares two images with the given comparison \p options and returns comparison result.
+  /*!
+    If both images have tile indexes, only the tiles with different hashes are
+    compared pixel by pixel (see Image::buildTileIndex()).
+
+    \param image1 An actual image to compare
+    \param image2 A baseline image to compare with. The diff outline will be drawn on this image
+    \param options The comparison options
+  */
+  static Result compare(const Image &image1, const Image &image2, const Options &options);
+
+  //! Compares pixel data of two image views and returns comparison result.
+  /*!
+    The views may have different pixel formats and strides. The result image
+    is a copy of \p image2 converted to RGB with the diff outlines drawn on it.
+
+    \param image1 An actual image to compare
+    \param image2 A baseline image to compare with
+    \param options The comparison options
+  */
+  static Result compare(const ImageView &image1, const ImageView &image2,
+                        const Options &options = Options());
+
+  //! Checks whether two image files have identical pixels.
+  /*!
+    Returns false if any of the files can't be read or the images have different
+    dimensions.
+  */
+  static bool isIdentical(const std::string &file1, const std::string &file2);
+
+  //! Checks whether two images are identical according to the comparison \p options.
+  /*!
+    Unlike compare() it stops at the first difference found and neither builds the
+    difference contours nor the result image, so it's the cheapest way to get a
+    yes/no answer. Returns false for invalid images or images of different dimensions.
+  */
+  static bool isIdentical(const Image &image1, const Image &image2,
+                          const Options &options = Options());
+
+  //! Checks whether pixel data of two image views are identical according to the \p options.
+  static bool isIdentical(const ImageView &image1, const ImageView &image2,
+                          const Options &options = Options());
+
+  //! Returns the name of the instruction set the comparison kernels use.
+  /*!
+    The kernels are selected at the first use according to the CPU features:
+    "avx512", "avx2", "sse4.1" or "scalar" on x86, "neon" or "scalar" on ARM.
+    The selection can be overridden by setting the NKAR_KERNEL environment
+    variable to the name of another kernel set supported by the CPU.
+  */
+  static std::string kernelName();
 };
 
 }
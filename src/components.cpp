@@ -0,0 +1,87 @@
+/**********************************************************************************
+*  MIT License                                                                    *
+*                                                                                 *
+*  Copyright (c) 2022 Vahan Aghajanyan <vahancho@gmail.com>                       *
+*                                                                                 *
+*  Permission is hereby granted, free of charge, to any person obtaining a copy   *
+*  of this software and associated documentation files (the "Software"), to deal  *
+*  in the Software without restriction, including without limitation the rights   *
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+*  copies of the Software, and to permit persons to whom the Software is          *
+*  furnished to do so, subject to the following conditions:                       *
+*                                                                                 *
+*  The above copyright notice and this permission notice shall be included in all *
+*  copies or substantial portions of the Software.                                *
+*                                                                                 *
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+*  SOFTWARE.                                                                      *
+***********************************************************************************/
+
+#include "components.h"
+
+namespace nkar
+{
+
+Components::Components()
+{}
+
+size_t Components::size() const
+{
+  return m_pixelCounts.size();
+}
+
+bool Components::isEmpty() const
+{
+  return m_pixelCounts.empty();
+}
+
+const std::vector<size_t> &Components::pixelCounts() const
+{
+  return m_pixelCounts;
+}
+
+const std::vector<Rect> &Components::boundingBoxes() const
+{
+  return m_boundingBoxes;
+}
+
+const std::vector<double> &Components::centroidsX() const
+{
+  return m_centroidsX;
+}
+
+const std::vector<double> &Components::centroidsY() const
+{
+  return m_centroidsY;
+}
+
+const std::vector<uint8_t> &Components::maxDeltas(Channel channel) const
+{
+  return m_maxDeltas[(int)channel];
+}
+
+const std::vector<double> &Components::meanDeltas(Channel channel) const
+{
+  return m_meanDeltas[(int)channel];
+}
+
+void Components::addComponent(size_t pixelCount, const Rect &boundingBox, double centroidX,
+                              double centroidY, const uint8_t maxDelta[3],
+                              const double meanDelta[3])
+{
+  m_pixelCounts.push_back(pixelCount);
+  m_boundingBoxes.push_back(boundingBox);
+  m_centroidsX.push_back(centroidX);
+  m_centroidsY.push_back(centroidY);
+  for (int channel = 0; channel < 3; ++channel) {
+    m_maxDeltas[channel].push_back(maxDelta[channel]);
+    m_meanDeltas[channel].push_back(meanDelta[channel]);
+  }
+}
+
+}
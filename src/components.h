@@ -0,0 +1,110 @@
+/**********************************************************************************
+*  MIT License                                                                    *
+*                                                                                 *
+*  Copyright (c) 2022 Vahan Aghajanyan <vahancho@gmail.com>                       *
+*                                                                                 *
+*  Permission is hereby granted, free of charge, to any person obtaining a copy   *
+*  of this software and associated documentation files (the "Software"), to deal  *
+*  in the Software without restriction, including without limitation the rights   *
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+*  copies of the Software, and to permit persons to whom the Software is          *
+*  furnished to do so, subject to the following conditions:                       *
+*                                                                                 *
+*  The above copyright notice and this permission notice shall be included in all *
+*  copies or substantial portions of the Software.                                *
+*                                                                                 *
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+*  SOFTWARE.                                                                      *
+***********************************************************************************/
+
+#ifndef _COMPONENTS_H_
+#define _COMPONENTS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "export.h"
+#include "rect.h"
+
+namespace nkar
+{
+
+//! Implements statistics of the difference components.
+/*!
+  A component is a group of different blocks, that touch each other at least by
+  corners, i.e. a region enclosed by an outer outline of a contour. The statistics
+  describe the different pixels of each component and are stored as a structure of
+  arrays: each statistic is an array with one element per component, so ranking the
+  components by any of them touches only the data of that statistic.
+
+  The pixel deltas are absolute differences of the red, green and blue channels of
+  the different pixels of two images.
+*/
+class NKAR_EXPORT Components
+{
+public:
+  //! The color channels of the pixel deltas.
+  enum class Channel
+  {
+    Red,
+    Green,
+    Blue
+  };
+
+  //! Constructs an empty set of components.
+  Components();
+
+  //! Returns the number of components.
+  size_t size() const;
+
+  //! Returns true if there are no components.
+  bool isEmpty() const;
+
+  //! Returns the numbers of different pixels of the components.
+  const std::vector<size_t> &pixelCounts() const;
+
+  //! Returns the bounding boxes of the different pixels of the components.
+  const std::vector<Rect> &boundingBoxes() const;
+
+  //! Returns the x coordinates of the centroids of the different pixels of the components.
+  const std::vector<double> &centroidsX() const;
+
+  //! Returns the y coordinates of the centroids of the different pixels of the components.
+  const std::vector<double> &centroidsY() const;
+
+  //! Returns the maximum deltas of the given \p channel of the components.
+  const std::vector<uint8_t> &maxDeltas(Channel channel) const;
+
+  //! Returns the mean deltas of the given \p channel of the components.
+  const std::vector<double> &meanDeltas(Channel channel) const;
+
+  //! Appends a component.
+  /*!
+    \param pixelCount The number of different pixels
+    \param boundingBox The bounding box of the different pixels
+    \param centroidX The x coordinate of the centroid of the different pixels
+    \param centroidY The y coordinate of the centroid of the different pixels
+    \param maxDelta The maximum deltas of the red, green and blue channels
+    \param meanDelta The mean deltas of the red, green and blue channels
+  */
+  void addComponent(size_t pixelCount, const Rect &boundingBox, double centroidX,
+                    double centroidY, const uint8_t maxDelta[3], const double meanDelta[3]);
+
+private:
+  std::vector<size_t> m_pixelCounts;
+  std::vector<Rect> m_boundingBoxes;
+  std::vector<double> m_centroidsX;
+  std::vector<double> m_centroidsY;
+  std::vector<uint8_t> m_maxDeltas[3];
+  std::vector<double> m_meanDeltas[3];
+};
+
+}
+
+#endif // _COMPONENTS_H_
@@ -0,0 +1,247 @@
+/**********************************************************************************
+*  MIT License                                                                    *
+*                                                                                 *
+*  Copyright (c) 2022 Vahan Aghajanyan <vahancho@gmail.com>                       *
+*                                                                                 *
+*  Permission is hereby granted, free of charge, to any person obtaining a copy   *
+*  of this software and associated documentation files (the "Software"), to deal  *
+*  in the Software without restriction, including without limitation the rights   *
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+*  copies of the Software, and to permit persons to whom the Software is          *
+*  furnished to do so, subject to the following conditions:                       *
+*                                                                                 *
+*  The above copyright notice and this permission notice shall be included in all *
+*  copies or substantial portions of the Software.                                *
+*                                                                                 *
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+*  SOFTWARE.                                                                      *
+***********************************************************************************/
+
+#include <algorithm>
+#include <cassert>
+#include <utility>
+
+#include "contours.h"
+
+namespace nkar
+{
+
+const size_t Contours::npos;
+
+Contours::Contours()
+  :
+    m_offsets(1, 0)
+{}
+
+size_t Contours::size() const
+{
+  return m_contours.size();
+}
+
+bool Contours::isEmpty() const
+{
+  return m_contours.empty();
+}
+
+const Point *Contours::polygon(size_t polygon) const
+{
+  assert(polygon < size());
+  return m_vertices.data() + m_offsets[polygon];
+}
+
+size_t Contours::vertexCount(size_t polygon) const
+{
+  assert(polygon < size());
+  return m_offsets[polygon + 1] - m_offsets[polygon];
+}
+
+size_t Contours::contour(size_t polygon) const
+{
+  assert(polygon < size());
+  return m_contours[polygon];
+}
+
+size_t Contours::parent(size_t polygon) const
+{
+  assert(polygon < size());
+  return m_parents[polygon];
+}
+
+bool Contours::isHole(size_t polygon) const
+{
+  assert(polygon < size());
+  return m_holes[polygon];
+}
+
+size_t Contours::area(size_t polygon) const
+{
+  const Point *vertices = this->polygon(polygon);
+  const size_t count = vertexCount(polygon);
+
+  // The shoelace formula.
+  long long area = 0;
+  for (size_t i = 0; i < count; ++i) {
+    const Point &next = vertices[i + 1 < count ? i + 1 : 0];
+    area += (long long)vertices[i].x() * next.y() - (long long)next.x() * vertices[i].y();
+  }
+  return (size_t)(area < 0 ? -area : area) / 2;
+}
+
+const std::vector<Point> &Contours::vertices() const
+{
+  return m_vertices;
+}
+
+const std::vector<size_t> &Contours::offsets() const
+{
+  return m_offsets;
+}
+
+//! Returns the squared distance from the \p point to the segment from \p begin to \p end
+//! multiplied by the squared length of the segment.
+/*!
+  The scaled distance is compared with the scaled tolerance, so no division is needed.
+  A segment of zero length is treated as having the unit length.
+*/
+static double scaledDistance(const Point &point, const Point &begin, const Point &end)
+{
+  const double dx = end.x() - begin.x();
+  const double dy = end.y() - begin.y();
+  const double px = point.x() - begin.x();
+  const double py = point.y() - begin.y();
+  const double length = dx * dx + dy * dy;
+  const double dot = px * dx + py * dy;
+
+  if (length == 0 || dot <= 0) {
+    // The point is closest to the beginning of the segment.
+    return (px * px + py * py) * std::max(length, 1.0);
+  } else if (dot >= length) {
+    const double ex = point.x() - end.x();
+    const double ey = point.y() - end.y();
+    return (ex * ex + ey * ey) * length;
+  }
+  const double cross = dx * py - dy * px;
+  return cross * cross;
+}
+
+void Contours::simplify(double tolerance)
+{
+  if (tolerance <= 0) {
+    return;
+  }
+
+  // The flags of the kept vertices of a polygon and the ranges of vertices to check.
+  std::vector<char> keep;
+  std::vector<std::pair<size_t, size_t>> ranges;
+
+  size_t begin = m_offsets[0];
+  size_t output = 0;
+  for (size_t polygon = 0; polygon < size(); ++polygon) {
+    const size_t end = m_offsets[polygon + 1];
+    const size_t count = end - begin;
+    const Point *vertices = m_vertices.data() + begin;
+    auto vertex = [vertices, count](size_t index) {
+      return vertices[index < count ? index : 0];
+    };
+
+    // The closed polygon is split into two chains by the first vertex and the
+    // vertex farthest from it.
+    size_t farthest = 0;
+    double distance = 0;
+    for (size_t i = 1; i < count; ++i) {
+      const double d = scaledDistance(vertices[i], vertices[0], vertices[0]);
+      if (d > distance) {
+        distance = d;
+        farthest = i;
+      }
+    }
+
+    keep.assign(count, 0);
+    size_t kept = 0;
+    if (count > 0) {
+      keep[0] = 1;
+      keep[farthest] = 1;
+      kept = farthest > 0 ? 2 : 1;
+      ranges.emplace_back(0, farthest);
+      ranges.emplace_back(farthest, count);
+    }
+
+    while (!ranges.empty()) {
+      const size_t first = ranges.back().first;
+      const size_t last = ranges.back().second;
+      ranges.pop_back();
+
+      const Point &from = vertex(first);
+      const Point &to = vertex(last);
+      const double dx = to.x() - from.x();
+      const double dy = to.y() - from.y();
+      const double limit = tolerance * tolerance * std::max(dx * dx + dy * dy, 1.0);
+
+      size_t split = first;
+      double maxDistance = limit;
+      for (size_t i = first + 1; i < last; ++i) {
+        const double d = scaledDistance(vertices[i], from, to);
+        if (d > maxDistance) {
+          maxDistance = d;
+          split = i;
+        }
+      }
+      if (split != first) {
+        keep[split] = 1;
+        ++kept;
+        ranges.emplace_back(first, split);
+        ranges.emplace_back(split, last);
+      }
+    }
+
+    // A polygon needs at least three vertices, so the vertex farthest from the
+    // line through the two kept ones is restored.
+    if (kept < 3 && count >= 3) {
+      size_t split = 0;
+      double maxDistance = -1;
+      for (size_t i = 1; i < count; ++i) {
+        const double d = scaledDistance(vertices[i], vertices[0], vertices[farthest]);
+        if (!keep[i] && d > maxDistance) {
+          maxDistance = d;
+          split = i;
+        }
+      }
+      keep[split] = 1;
+    }
+
+    // The kept vertices are moved towards the beginning of the array.
+    m_offsets[polygon] = output;
+    for (size_t i = 0; i < count; ++i) {
+      if (keep[i]) {
+        m_vertices[output++] = vertices[i];
+      }
+    }
+    begin = end;
+  }
+
+  m_offsets.back() = output;
+  m_vertices.resize(output);
+}
+
+void Contours::addPolygon(size_t contour, bool hole, size_t parent)
+{
+  assert(parent == npos || parent < size());
+  m_contours.push_back(contour);
+  m_parents.push_back(parent);
+  m_holes.push_back(hole);
+  m_offsets.push_back(m_vertices.size());
+}
+
+void Contours::addVertex(const Point &vertex)
+{
+  assert(!isEmpty());
+  m_vertices.push_back(vertex);
+  ++m_offsets.back();
+}
+
+}
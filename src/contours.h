@@ -0,0 +1,138 @@
+/**********************************************************************************
+*  MIT License                                                                    *
+*                                                                                 *
+*  Copyright (c) 2022 Vahan Aghajanyan <vahancho@gmail.com>                       *
+*                                                                                 *
+*  Permission is hereby granted, free of charge, to any person obtaining a copy   *
+*  of this software and associated documentation files (the "Software"), to deal  *
+*  in the Software without restriction, including without limitation the rights   *
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+*  copies of the Software, and to permit persons to whom the Software is          *
+*  furnished to do so, subject to the following conditions:                       *
+*                                                                                 *
+*  The above copyright notice and this permission notice shall be included in all *
+*  copies or substantial portions of the Software.                                *
+*                                                                                 *
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+*  SOFTWARE.                                                                      *
+***********************************************************************************/
+
+#ifndef _CONTOURS_H_
+#define _CONTOURS_H_
+
+#include <cstddef>
+#include <vector>
+
+#include "export.h"
+#include "point.h"
+
+namespace nkar
+{
+
+//! Implements a set of difference contours as closed polygons.
+/*!
+  Each polygon is an ordered loop of vertices, that are the corners of an outline:
+  every two consecutive vertices (and the last and the first ones) are connected
+  by a horizontal or vertical segment, and no three consecutive vertices lie on one
+  line. Simplified polygons keep only some of the corners (see simplify()). The
+  outlines go clockwise around different regions, i.e. the different pixels are on
+  the right-hand side of the outline in image coordinates, and counter clockwise
+  around holes in them.
+
+  The vertices of all polygons are stored in one flat array. The vertices of the
+  polygon \c i are in the range from <tt>offsets()[i]</tt> to <tt>offsets()[i + 1]</tt>.
+
+  The polygons form a tree like nested regions do: the parent of an outer outline is
+  the hole it lies in, and the parent of a hole is the outer outline of the region
+  it's cut in. A parent precedes its children, so the tree can be processed in a
+  single pass over the polygons.
+*/
+class NKAR_EXPORT Contours
+{
+public:
+  //! The polygon index, that stands for no polygon.
+  static const size_t npos = size_t(-1);
+
+  //! Constructs an empty set of contours.
+  Contours();
+
+  //! Returns the number of polygons.
+  size_t size() const;
+
+  //! Returns true if there are no polygons.
+  bool isEmpty() const;
+
+  //! Returns a pointer to the first vertex of the given \p polygon.
+  const Point *polygon(size_t polygon) const;
+
+  //! Returns the number of vertices of the given \p polygon.
+  size_t vertexCount(size_t polygon) const;
+
+  //! Returns the index of the contour the given \p polygon belongs to.
+  /*!
+    A contour can consist of several polygons: the outer outline of a group of
+    differences and outlines of holes, that touch it.
+
+    \sa Result::contourCount()
+  */
+  size_t contour(size_t polygon) const;
+
+  //! Returns the index of the polygon, that immediately encloses the given \p polygon.
+  /*!
+    Returns npos for the outer outlines, that aren't inside any hole.
+  */
+  size_t parent(size_t polygon) const;
+
+  //! Returns true if the given \p polygon is an outline of a hole.
+  bool isHole(size_t polygon) const;
+
+  //! Returns the area enclosed by the given \p polygon in square pixels.
+  /*!
+    The area of a region is the area of its outer outline minus the areas of its holes,
+    i.e. of the hole polygons, that have the outline as their parent.
+  */
+  size_t area(size_t polygon) const;
+
+  //! Returns the vertices of all polygons.
+  const std::vector<Point> &vertices() const;
+
+  //! Returns the offsets of polygons in the vertices array followed by its size.
+  const std::vector<size_t> &offsets() const;
+
+  //! Simplifies the polygons with the Douglas-Peucker algorithm.
+  /*!
+    Removes vertices, so that no removed vertex is farther than \p tolerance pixels
+    from the simplified outline. This turns long staircase outlines of diagonal
+    differences into a few slanted segments. Each polygon keeps at least three
+    vertices. The vertices are removed in place, and the work buffers are shared by
+    all polygons. Non-positive tolerance leaves the polygons intact.
+  */
+  void simplify(double tolerance);
+
+  //! Starts a new polygon of the given \p contour.
+  /*!
+    \param contour The index of the contour the polygon belongs to
+    \param hole Whether the polygon is an outline of a hole
+    \param parent The index of the enclosing polygon or npos
+  */
+  void addPolygon(size_t contour, bool hole = false, size_t parent = npos);
+
+  //! Appends the \p vertex to the last polygon.
+  void addVertex(const Point &vertex);
+
+private:
+  std::vector<Point> m_vertices;
+  std::vector<size_t> m_offsets;
+  std::vector<size_t> m_contours;
+  std::vector<size_t> m_parents;
+  std::vector<bool> m_holes;
+};
+
+}
+
+#endif // _CONTOURS_H_
@@ -23,6 +23,10 @@
 ***********************************************************************************/
 
 #include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <utility>
 
 #include "image.h"
 #include "point.h"
@@ -49,37 +53,98 @@
 namespace nkar
 {
 
+//! The alignment of rows of 4 bytes per pixel formats in bytes.
+static const int s_rowAlignment = 64;
+
+//! Frees the pixel data allocated by stb or malloc().
+static void freePixels(unsigned char *data)
+{
+  stbi_image_free(data);
+}
+
+//! Allocates the pixel data of the given \p size, that starts at a row alignment boundary.
+/*!
+  Throws std::bad_alloc if the memory can't be allocated, as the copies of bands do.
+*/
+static std::shared_ptr<unsigned char> allocateAligned(size_t size)
+{
+  unsigned char *data = (unsigned char *)malloc(size + s_rowAlignment - 1);
+  if (data == nullptr) {
+    throw std::bad_alloc();
+  }
+  const size_t offset = (s_rowAlignment - (uintptr_t)data % s_rowAlignment) % s_rowAlignment;
+  return std::shared_ptr<unsigned char>(data + offset, [data](unsigned char *) {
+    freePixels(data);
+  });
+}
+
+//! Returns the format, that the pixel data in the given \p format is stored in.
+static PixelFormat storageFormat(PixelFormat format)
+{
+  switch (format)
+  {
+  case PixelFormat::RGBA:
+  case PixelFormat::BGRA:
+    return PixelFormat::RGBA;
+  case PixelFormat::RGBX:
+  case PixelFormat::BGRX:
+    return PixelFormat::RGBX;
+  default:
+    return PixelFormat::RGB;
+  }
+}
+
 Image::Image()
   :
-    m_data(nullptr),
     m_width(0),
-    m_height(0)
+    m_height(0),
+    m_stride(0),
+    m_format(PixelFormat::RGB)
 {}
 
-Image::Image(const std::string &file)
+Image::Image(const std::string &file, PixelFormat format)
   :
-    m_data(nullptr),
     m_width(0),
-    m_height(0)
+    m_height(0),
+    m_stride(0),
+    m_format(storageFormat(format))
 {
   open(file);
 }
 
-Image::Image(const Image &other)
+Image::Image(const ImageView &view, PixelFormat format)
+  :
+    m_width(0),
+    m_height(0),
+    m_stride(0),
+    m_format(storageFormat(format))
 {
-  m_width = other.m_width;
-  m_height = other.m_height;
+  assign(view);
+}
 
-  const size_t size = m_width * m_height * STBI_rgb;
-  m_data = (unsigned char *)malloc(size);
-  memcpy(m_data, other.m_data, size);
+Image::Image(const Image &other)
+  :
+    m_width(0),
+    m_height(0),
+    m_stride(0),
+    m_format(PixelFormat::RGB)
+{
+  *this = other;
 }
 
-Image::~Image()
+Image::Image(Image &&other) noexcept
+  :
+    m_width(0),
+    m_height(0),
+    m_stride(0),
+    m_format(PixelFormat::RGB)
 {
-  stbi_image_free(m_data);
+  *this = std::move(other);
 }
 
+Image::~Image()
+{}
+
 bool Image::open(const std::string &file)
 {
   // We use stbi_load() function here to avoid additional dependencies.
@@ -88,15 +153,65 @@ bool Image::open(const std::string &file)
   // QImage image(m_file.c_str());
   // m_data = image.bits();
   // ...
+  const int channels = m_format == PixelFormat::RGB ? STBI_rgb : STBI_rgb_alpha;
+  int width = 0;
+  int height = 0;
   int n = 0;
-  m_data = stbi_load(file.c_str(), &m_width, &m_height, &n, STBI_rgb);
-  if (m_data == nullptr) {
+  unsigned char *data = stbi_load(file.c_str(), &width, &height, &n, channels);
+  if (data == nullptr) {
     fprintf(stderr, "Error reading image file %s\n", file.c_str());
     return false;
   }
+
+  if (m_format == PixelFormat::RGB) {
+    m_width = width;
+    m_height = height;
+    m_stride = width * STBI_rgb;
+    m_data.reset(data, freePixels);
+  } else {
+    // The rows are realigned.
+    assign(ImageView(data, width, height, width * STBI_rgb_alpha, m_format));
+    freePixels(data);
+  }
   return true;
 }
 
+void Image::assign(const ImageView &view)
+{
+  if (view.isNull()) {
+    return;
+  }
+
+  m_width = view.width();
+  m_height = view.height();
+  m_stride = m_width * bytesPerPixel();
+  if (m_format != PixelFormat::RGB) {
+    m_stride = (m_stride + s_rowAlignment - 1) / s_rowAlignment * s_rowAlignment;
+  }
+  m_data = allocateAligned((size_t)m_stride * m_height);
+
+  const bool alpha = view.format() == PixelFormat::RGBA || view.format() == PixelFormat::BGRA;
+  for (int row = 0; row < m_height; ++row) {
+    unsigned char *target = m_data.get() + (size_t)row * m_stride;
+    if (view.format() == m_format) {
+      memcpy(target, view.scanline(row), (size_t)m_width * bytesPerPixel());
+      continue;
+    }
+
+    view.convertRow(row, target);
+    if (m_format != PixelFormat::RGB) {
+      // Spread the RGB pixels in place starting from the last one.
+      const uint8_t *source = view.scanline(row);
+      for (int x = m_width - 1; x >= 0; --x) {
+        target[4 * x + 3] = alpha ? source[4 * x + 3] : 255;
+        target[4 * x + 2] = target[3 * x + 2];
+        target[4 * x + 1] = target[3 * x + 1];
+        target[4 * x] = target[3 * x];
+      }
+    }
+  }
+}
+
 bool Image::isNull() const
 {
   return !m_data;
@@ -112,6 +227,21 @@ int Image::height() const
   return m_height;
 }
 
+PixelFormat Image::format() const
+{
+  return m_format;
+}
+
+int Image::stride() const
+{
+  return m_stride;
+}
+
+int Image::bytesPerPixel() const
+{
+  return m_format == PixelFormat::RGB ? STBI_rgb : STBI_rgb_alpha;
+}
+
 Color Image::pixel(int row, int column) const
 {
   if (isNull()) {
@@ -120,15 +250,40 @@ Color Image::pixel(int row, int column) const
 
   assert(row < m_height && column < m_width);
 
-  auto pos = (row * m_width + column) * STBI_rgb;
+  const unsigned char *pixel = scanline(row) + column * bytesPerPixel();
 
-  auto red   = m_data[pos];
-  auto green = m_data[pos + 1];
-  auto blue  = m_data[pos + 2];
+  auto red   = pixel[0];
+  auto green = pixel[1];
+  auto blue  = pixel[2];
 
   return{ red, green, blue };
 }
 
+const unsigned char *Image::scanline(int row) const
+{
+  if (isNull()) {
+    return nullptr;
+  }
+
+  assert(row < m_height);
+
+  if (!m_bands.empty()) {
+    const auto &band = m_bands[row / TileIndex::tileSize()];
+    if (band) {
+      return band.get() + (size_t)(row % TileIndex::tileSize()) * m_stride;
+    }
+  }
+  return m_data.get() + (size_t)row * m_stride;
+}
+
+ImageView Image::view() const
+{
+  if (isNull()) {
+    return ImageView();
+  }
+  return ImageView(contiguousData(), m_width, m_height, m_stride, m_format);
+}
+
 void Image::setPixel(int row, int column, const Color &color)
 {
   if (isNull()) {
@@ -137,11 +292,67 @@ void Image::setPixel(int row, int column, const Color &color)
 
   assert(row < m_height && column < m_width);
 
-  auto pos = (row * m_width + column) * STBI_rgb;
+  unsigned char *pixel = modifiableScanline(row) + column * bytesPerPixel();
+
+  pixel[0] = color.red();
+  pixel[1] = color.green();
+  pixel[2] = color.blue();
+  if (m_format == PixelFormat::RGBA) {
+    pixel[3] = 255;
+  }
+}
+
+unsigned char *Image::modifiableScanline(int row)
+{
+  if (m_merged) {
+    // The contiguous copy already has all modified bands.
+    m_data = std::move(m_merged);
+    m_bands.clear();
+  }
+
+  const int band = row / TileIndex::tileSize();
+  if (m_bands.empty()) {
+    if (m_data.use_count() == 1) {
+      return m_data.get() + (size_t)row * m_stride;
+    }
+    m_bands.resize((m_height + TileIndex::tileSize() - 1) / TileIndex::tileSize());
+  }
+
+  auto &copy = m_bands[band];
+  if (!copy) {
+    // Copy the band on the first write.
+    const unsigned char *source = m_data.get() + (size_t)band * TileIndex::tileSize() * m_stride;
+    copy.reset(new unsigned char[bandSize(band)]);
+    memcpy(copy.get(), source, bandSize(band));
+  }
+  return copy.get() + (size_t)(row % TileIndex::tileSize()) * m_stride;
+}
+
+size_t Image::bandSize(int band) const
+{
+  const int rows = std::min(TileIndex::tileSize(), m_height - band * TileIndex::tileSize());
+  return (size_t)rows * m_stride;
+}
 
-  m_data[pos]     = color.red();
-  m_data[pos + 1] = color.green();
-  m_data[pos + 2] = color.blue();
+const unsigned char *Image::contiguousData() const
+{
+  // The pixel data and the bands don't change while the image is const.
+  if (m_bands.empty()) {
+    return m_data.get();
+  }
+
+  std::lock_guard<std::mutex> lock(m_mergeMutex);
+  if (!m_merged) {
+    const size_t bandStride = (size_t)TileIndex::tileSize() * m_stride;
+    std::shared_ptr<unsigned char> data = allocateAligned((size_t)m_stride * m_height);
+    for (int band = 0; band < (int)m_bands.size(); ++band) {
+      const unsigned char *source = m_bands[band] ? m_bands[band].get()
+                                                  : m_data.get() + band * bandStride;
+      memcpy(data.get() + band * bandStride, source, bandSize(band));
+    }
+    m_merged = std::move(data);
+  }
+  return m_merged.get();
 }
 
 //! Draws either a horizontal or vertical line.
@@ -151,6 +362,9 @@ void Image::drawLine(const Point &start, const Point &end, const Color &color)
     return;
   }
 
+  // The pixels are changing, so the index is not valid anymore.
+  m_tileIndex = TileIndex();
+
   for (int c = std::min(start.x(), end.x()); c <= std::max(start.x(), end.x()); ++c) {
     for (int r = std::min(start.y(), end.y()); r <= std::max(start.y(), end.y()); ++r) {
       setPixel(r, c, color);
@@ -158,6 +372,26 @@ void Image::drawLine(const Point &start, const Point &end, const Color &color)
   }
 }
 
+const TileIndex &Image::tileIndex() const
+{
+  return m_tileIndex;
+}
+
+void Image::buildTileIndex(int threadCount)
+{
+  m_tileIndex = TileIndex(view(), threadCount);
+}
+
+bool Image::setTileIndex(const TileIndex &index)
+{
+  if (index.width() != m_width || index.height() != m_height || index.format() != m_format) {
+    return false;
+  }
+
+  m_tileIndex = index;
+  return true;
+}
+
 bool Image::save(const std::string &file) const
 {
   if (isNull())
@@ -165,21 +399,76 @@ bool Image::save(const std::string &file) const
     return false;
   }
 
+  if (m_format == PixelFormat::RGBX) {
+    // The unused bytes are not saved.
+    std::vector<unsigned char> data((size_t)m_width * m_height * STBI_rgb);
+    const ImageView image = view();
+    for (int row = 0; row < m_height; ++row) {
+      image.convertRow(row, data.data() + (size_t)row * m_width * STBI_rgb);
+    }
+    return stbi_write_png(file.c_str(), width(), height(),
+                          STBI_rgb, data.data(), width() * STBI_rgb) != 0;
+  }
   return stbi_write_png(file.c_str(), width(), height(),
-                        STBI_rgb, m_data, width() * STBI_rgb) != 0;
+                        bytesPerPixel(), contiguousData(), m_stride) != 0;
 }
 
 Image &Image::operator=(const Image &other)
 {
-  // Delete old data.
-  stbi_image_free(m_data);
+  if (this == &other) {
+    return *this;
+  }
 
   m_width = other.m_width;
   m_height = other.m_height;
+  m_stride = other.m_stride;
+  m_format = other.m_format;
+  m_tileIndex = other.m_tileIndex;
+  m_merged.reset();
+  m_bands.clear();
+
+  // The other image may be viewed by other threads meanwhile.
+  std::unique_lock<std::mutex> lock(other.m_mergeMutex);
+  if (other.m_merged) {
+    m_data = other.m_merged;
+    return *this;
+  }
+  lock.unlock();
+
+  // The pixel data is shared, but the modified bands are not.
+  m_data = other.m_data;
+  m_bands.resize(other.m_bands.size());
+  for (int band = 0; band < (int)m_bands.size(); ++band) {
+    if (other.m_bands[band]) {
+      m_bands[band].reset(new unsigned char[bandSize(band)]);
+      memcpy(m_bands[band].get(), other.m_bands[band].get(), bandSize(band));
+    }
+  }
+
+  return *this;
+}
 
-  const size_t size = m_width * m_height * STBI_rgb;
-  m_data = (unsigned char *)malloc(size);
-  memcpy(m_data, other.m_data, size);
+Image &Image::operator=(Image &&other) noexcept
+{
+  if (this == &other) {
+    return *this;
+  }
+
+  m_data = std::move(other.m_data);
+  m_bands = std::move(other.m_bands);
+  m_merged = std::move(other.m_merged);
+  m_width = other.m_width;
+  m_height = other.m_height;
+  m_stride = other.m_stride;
+  m_format = other.m_format;
+  m_tileIndex = std::move(other.m_tileIndex);
+
+  other.m_bands.clear();
+  other.m_width = 0;
+  other.m_height = 0;
+  other.m_stride = 0;
+  other.m_format = PixelFormat::RGB;
+  other.m_tileIndex = TileIndex();
 
   return *this;
 }
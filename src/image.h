@@ -25,9 +25,14 @@
 #ifndef _IMAGE_H_
 #define _IMAGE_H_
 
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 #include "color.h"
 #include "export.h"
+#include "imageview.h"
+#include "tileindex.h"
 
 namespace nkar
 {
@@ -35,6 +40,18 @@ namespace nkar
 class Point;
 
 //! Implements an image data representation.
+/*!
+  Copies of an image share its pixel data. Modifying a copy copies only the touched
+  bands of rows, that are one tile high (see TileIndex::tileSize()), so the highlighted
+  comparison result doesn't duplicate the whole compared image. Once the pixel data
+  is needed entirely, i.e. by view() and save(), its contiguous copy is made under
+  a lock, so a const image can still be read from several threads. The next
+  modification takes over the copy instead of the bands.
+
+  The pixels are stored in the RGB format by default. The 4 bytes per pixel RGBA and
+  RGBX formats can be chosen instead: their rows start at 64 byte boundaries, and such
+  images are compared with 32-bit lanes. The RGBA format keeps the alpha channel.
+*/
 class NKAR_EXPORT Image
 {
 public:
@@ -45,11 +62,33 @@ public:
   Image();
 
   //! Constructs an image object and fills it with the image data
-  Image(const std::string &file);
+  /*!
+    The pixel data is stored in the given \p format, that is one of RGB, RGBA or RGBX.
+    The BGR formats are replaced by their RGB counterparts.
+  */
+  Image(const std::string &file, PixelFormat format = PixelFormat::RGB);
+
+  //! Constructs an image object with a copy of the pixel data the \p view refers to.
+  /*!
+    The pixel data is converted to the given \p format, that is one of RGB, RGBA
+    or RGBX. The BGR formats are replaced by their RGB counterparts. The alpha channel
+    is kept if the \p view has it and is opaque otherwise.
+  */
+  explicit Image(const ImageView &view, PixelFormat format = PixelFormat::RGB);
 
   //! Copy constructor
+  /*!
+    The copy shares the pixel data with the \p other image until either is modified.
+  */
   Image(const Image &other);
 
+  //! Move constructor
+  /*!
+    Takes over the pixel data of the \p other image without copying it and leaves
+    the \p other image empty.
+  */
+  Image(Image &&other) noexcept;
+
   //! Destructor
   ~Image();
 
@@ -65,17 +104,63 @@ public:
   */
   int height() const;
 
+  //! Returns the pixel format of the image data.
+  PixelFormat format() const;
+
+  //! Returns the number of bytes between the beginnings of two consecutive rows.
+  int stride() const;
+
   //! Returns color of the given image pixel.
   Color pixel(int row, int column) const;
 
+  //! Returns a pointer to the pixel data of the given \p row in the image format.
+  /*!
+    Returns nullptr for an empty image.
+  */
+  const unsigned char *scanline(int row) const;
+
+  //! Returns a view of the image pixel data.
+  /*!
+    The view stays valid as long as the image exists and isn't modified. If bands
+    of the shared pixel data were modified, the contiguous copy of the data is made
+    on the first call.
+  */
+  ImageView view() const;
+
   //! Returns true if image object represents an empty image.
   bool isNull() const;
 
   //! Draws either a horizontal or vertical line.
+  /*!
+    The tile index of the image is reset.
+  */
   void drawLine(const Point &start, const Point &end, const Color &color);
 
+  //! Returns the tile index of the image or an empty index if it's not built.
+  const TileIndex &tileIndex() const;
+
+  //! Builds the tile index of the image.
+  /*!
+    If both compared images have tile indexes, only the tiles with different
+    hashes are compared pixel by pixel.
+
+    \sa TileIndex
+  */
+  void buildTileIndex(int threadCount = 1);
+
+  //! Sets the previously built tile index of the image.
+  /*!
+    It allows reusing an index saved to a file instead of building it again.
+    The index must be built for an image with the same pixel data.
+
+    \return true on success and false if the index doesn't fit the image dimensions.
+  */
+  bool setTileIndex(const TileIndex &index);
+
   //! Save image to the given file.
   /*!
+    The image is saved with the alpha channel if its format is RGBA.
+
     \return true on success and false otherwise.
   */
   bool save(const std::string &file) const;
@@ -83,6 +168,13 @@ public:
   //! The assignment operator.
   Image &operator = (const Image &other);
 
+  //! The move assignment operator.
+  /*!
+    Takes over the pixel data of the \p other image without copying it and leaves
+    the \p other image empty.
+  */
+  Image &operator = (Image &&other) noexcept;
+
 private:
   //! Opens the image file.
   /*!
@@ -91,12 +183,43 @@ private:
   */
   bool open(const std::string &file);
 
+  //! Stores a copy of the pixel data the \p view refers to in the image format.
+  void assign(const ImageView &view);
+
+  //! Returns the number of bytes per pixel of the image format.
+  int bytesPerPixel() const;
+
   //! Sets color of the particular pixel.
   void setPixel(int row, int column, const Color &color);
 
-  unsigned char *m_data;
+  //! Returns a pointer to the pixel data of the given \p row for modification.
+  /*!
+    The band of the row is copied, if the pixel data is shared with other images.
+  */
+  unsigned char *modifiableScanline(int row);
+
+  //! Returns the size of the pixel data of the given \p band of rows in bytes.
+  size_t bandSize(int band) const;
+
+  //! Returns the contiguous pixel data with the modified bands.
+  /*!
+    The contiguous copy is made once under the lock, and the pixel data and
+    the bands are left intact.
+  */
+  const unsigned char *contiguousData() const;
+
+  //! The pixel data, that may be shared with the copies of the image.
+  std::shared_ptr<unsigned char> m_data;
+  //! The copies of the bands of rows, modified while the pixel data was shared.
+  std::vector<std::unique_ptr<unsigned char[]>> m_bands;
+  //! The contiguous copy of the pixel data with the modified bands and its lock.
+  mutable std::shared_ptr<unsigned char> m_merged;
+  mutable std::mutex m_mergeMutex;
   int m_width;
   int m_height;
+  int m_stride;
+  PixelFormat m_format;
+  TileIndex m_tileIndex;
 };
 
 }
@@ -0,0 +1,131 @@
+/**********************************************************************************
+*  MIT License                                                                    *
+*                                                                                 *
+*  Copyright (c) 2022 Vahan Aghajanyan <vahancho@gmail.com>                       *
+*                                                                                 *
+*  Permission is hereby granted, free of charge, to any person obtaining a copy   *
+*  of this software and associated documentation files (the "Software"), to deal  *
+*  in the Software without restriction, including without limitation the rights   *
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+*  copies of the Software, and to permit persons to whom the Software is          *
+*  furnished to do so, subject to the following conditions:                       *
+*                                                                                 *
+*  The above copyright notice and this permission notice shall be included in all *
+*  copies or substantial portions of the Software.                                *
+*                                                                                 *
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+*  SOFTWARE.                                                                      *
+***********************************************************************************/
+
+#include <cassert>
+#include <cstddef>
+
+#include "imageview.h"
+
+namespace nkar
+{
+
+//! Returns true if the red channel of the given pixel format comes last.
+static bool isBgr(PixelFormat format)
+{
+  return format == PixelFormat::BGR || format == PixelFormat::BGRA ||
+         format == PixelFormat::BGRX;
+}
+
+ImageView::ImageView()
+  :
+    m_data(nullptr),
+    m_width(0),
+    m_height(0),
+    m_stride(0),
+    m_format(PixelFormat::RGB)
+{}
+
+ImageView::ImageView(const uint8_t *data, int width, int height, int stride,
+                     PixelFormat format)
+  :
+    m_data(data),
+    m_width(width),
+    m_height(height),
+    m_stride(stride),
+    m_format(format)
+{
+  assert(!data || stride >= width * bytesPerPixel());
+}
+
+int ImageView::width() const
+{
+  return m_width;
+}
+
+int ImageView::height() const
+{
+  return m_height;
+}
+
+int ImageView::stride() const
+{
+  return m_stride;
+}
+
+PixelFormat ImageView::format() const
+{
+  return m_format;
+}
+
+int ImageView::bytesPerPixel() const
+{
+  return m_format == PixelFormat::RGB || m_format == PixelFormat::BGR ? 3 : 4;
+}
+
+bool ImageView::isNull() const
+{
+  return !m_data || m_width <= 0 || m_height <= 0;
+}
+
+const uint8_t *ImageView::scanline(int row) const
+{
+  if (isNull()) {
+    return nullptr;
+  }
+
+  assert(row < m_height);
+
+  return m_data + (size_t)row * m_stride;
+}
+
+Color ImageView::pixel(int row, int column) const
+{
+  if (isNull()) {
+    return Color();
+  }
+
+  assert(row < m_height && column < m_width);
+
+  const uint8_t *p = scanline(row) + column * bytesPerPixel();
+  if (isBgr(m_format)) {
+    return{ p[2], p[1], p[0] };
+  }
+  return{ p[0], p[1], p[2] };
+}
+
+void ImageView::convertRow(int row, uint8_t *target) const
+{
+  const uint8_t *p = scanline(row);
+  const int bpp = bytesPerPixel();
+  const int red = isBgr(m_format) ? 2 : 0;
+  const int blue = 2 - red;
+
+  for (int column = 0; column < m_width; ++column, p += bpp, target += 3) {
+    target[0] = p[red];
+    target[1] = p[1];
+    target[2] = p[blue];
+  }
+}
+
+}
@@ -0,0 +1,111 @@
+/**********************************************************************************
+*  MIT License                                                                    *
+*                                                                                 *
+*  Copyright (c) 2022 Vahan Aghajanyan <vahancho@gmail.com>                       *
+*                                                                                 *
+*  Permission is hereby granted, free of charge, to any person obtaining a copy   *
+*  of this software and associated documentation files (the "Software"), to deal  *
+*  in the Software without restriction, including without limitation the rights   *
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+*  copies of the Software, and to permit persons to whom the Software is          *
+*  furnished to do so, subject to the following conditions:                       *
+*                                                                                 *
+*  The above copyright notice and this permission notice shall be included in all *
+*  copies or substantial portions of the Software.                                *
+*                                                                                 *
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+*  SOFTWARE.                                                                      *
+***********************************************************************************/
+
+#ifndef _IMAGEVIEW_H_
+#define _IMAGEVIEW_H_
+
+#include <cstdint>
+
+#include "color.h"
+#include "export.h"
+
+namespace nkar
+{
+
+//! The memory layout of a pixel.
+enum class PixelFormat
+{
+  RGB,  //! 3 bytes per pixel: red, green, blue.
+  BGR,  //! 3 bytes per pixel: blue, green, red.
+  RGBA, //! 4 bytes per pixel: red, green, blue, alpha.
+  BGRA, //! 4 bytes per pixel: blue, green, red, alpha.
+  RGBX, //! 4 bytes per pixel: red, green, blue and an unused byte.
+  BGRX  //! 4 bytes per pixel: blue, green, red and an unused byte.
+};
+
+//! Implements a non-owning view of image pixel data.
+/*!
+  The view refers to pixel data owned by someone else, for instance a frame buffer
+  or a decoded video frame, so images can be compared without copying them. The
+  data must stay valid as long as the view is used.
+*/
+class NKAR_EXPORT ImageView
+{
+public:
+  //! Constructs an empty view.
+  ImageView();
+
+  //! Constructs a view of the pixel data.
+  /*!
+    \param data The first pixel of the first row
+    \param width The number of pixels in each row
+    \param height The number of rows
+    \param stride The number of bytes between the beginnings of two consecutive rows
+    \param format The pixel format
+  */
+  ImageView(const uint8_t *data, int width, int height, int stride,
+            PixelFormat format = PixelFormat::RGB);
+
+  //! Returns the width of the image.
+  int width() const;
+
+  //! Returns the height of the image.
+  int height() const;
+
+  //! Returns the number of bytes between the beginnings of two consecutive rows.
+  int stride() const;
+
+  //! Returns the pixel format.
+  PixelFormat format() const;
+
+  //! Returns the number of bytes per pixel.
+  int bytesPerPixel() const;
+
+  //! Returns true if the view refers to no data.
+  bool isNull() const;
+
+  //! Returns a pointer to the first pixel of the given \p row.
+  const uint8_t *scanline(int row) const;
+
+  //! Returns color of the given image pixel.
+  Color pixel(int row, int column) const;
+
+  //! Converts the given \p row to packed RGB pixels.
+  /*!
+    \param row The row to convert
+    \param target The buffer of at least <tt>3 * width()</tt> bytes
+  */
+  void convertRow(int row, uint8_t *target) const;
+
+private:
+  const uint8_t *m_data;
+  int m_width;
+  int m_height;
+  int m_stride;
+  PixelFormat m_format;
+};
+
+}
+
+#endif // _IMAGEVIEW_H_
@@ -0,0 +1,299 @@
+/**********************************************************************************
+*  MIT License                                                                    *
+*                                                                                 *
+*  Copyright (c) 2022 Vahan Aghajanyan <vahancho@gmail.com>                       *
+*                                                                                 *
+*  Permission is hereby granted, free of charge, to any person obtaining a copy   *
+*  of this software and associated documentation files (the "Software"), to deal  *
+*  in the Software without restriction, including without limitation the rights   *
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+*  copies of the Software, and to permit persons to whom the Software is          *
+*  furnished to do so, subject to the following conditions:                       *
+*                                                                                 *
+*  The above copyright notice and this permission notice shall be included in all *
+*  copies or substantial portions of the Software.                                *
+*                                                                                 *
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+*  SOFTWARE.                                                                      *
+***********************************************************************************/
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "kernels.h"
+#include "kernels_common.h"
+
+#if defined(NKAR_X86_KERNELS)
+  #if defined(_MSC_VER)
+    #include <intrin.h>
+  #else
+    #include <cpuid.h>
+  #endif
+#endif
+
+#if defined(NKAR_NEON_KERNELS)
+  #include <arm_neon.h>
+#endif
+
+namespace nkar
+{
+
+namespace kernels
+{
+
+namespace
+{
+
+uint64_t diffWordScalar(const uint8_t *p1, const uint8_t *p2)
+{
+  if (memcmp(p1, p2, s_bytesPerWord) == 0) {
+    return 0;
+  }
+  return diffPixels(p1, p2, s_pixelsPerWord);
+}
+
+uint64_t diffWord32Scalar(const uint8_t *p1, const uint8_t *p2, uint32_t channels)
+{
+  return diffPixels32(p1, p2, channels, s_pixelsPerWord);
+}
+
+uint64_t diffWordTolerantScalar(const uint8_t *p1, const uint8_t *p2,
+                                const Tolerance &tolerance)
+{
+  if (memcmp(p1, p2, s_pixelsPerWord * tolerance.bytesPerPixel) == 0) {
+    return 0;
+  }
+  return diffPixels(p1, p2, s_pixelsPerWord, tolerance);
+}
+
+bool equalScalar(const uint8_t *data1, const uint8_t *data2, size_t size)
+{
+  return memcmp(data1, data2, size) == 0;
+}
+
+#if defined(NKAR_NEON_KERNELS)
+
+bool equalBlockNeon(const uint8_t *p1, const uint8_t *p2)
+{
+  uint8x16_t diff = vdupq_n_u8(0);
+  for (int v = 0; v < 4; ++v) {
+    diff = vorrq_u8(diff, veorq_u8(vld1q_u8(p1 + v * 16), vld1q_u8(p2 + v * 16)));
+  }
+  return vmaxvq_u8(diff) == 0;
+}
+
+uint64_t diffWord32Neon(const uint8_t *p1, const uint8_t *p2, uint32_t channels)
+{
+  const uint32x4_t mask = vdupq_n_u32(channels);
+  uint32x4_t diff = vdupq_n_u32(0);
+  for (int v = 0; v < s_pixelsPerWord / 4; ++v) {
+    const uint32x4_t a = vld1q_u32((const uint32_t *)(p1 + v * 16));
+    const uint32x4_t b = vld1q_u32((const uint32_t *)(p2 + v * 16));
+    diff = vorrq_u32(diff, vandq_u32(veorq_u32(a, b), mask));
+  }
+  if (vmaxvq_u32(diff) == 0) {
+    return 0;
+  }
+  return diffPixels32(p1, p2, channels, s_pixelsPerWord);
+}
+
+template <int Bpp>
+uint64_t diffWordTolerantNeon(const uint8_t *p1, const uint8_t *p2, const Tolerance &tolerance)
+{
+  uint8x16_t over = vdupq_n_u8(0);
+  for (int v = 0; v < Bpp * 4; ++v) {
+    const uint8x16_t a = vld1q_u8(p1 + v * 16);
+    const uint8x16_t b = vld1q_u8(p2 + v * 16);
+    over = vorrq_u8(over, vqsubq_u8(vabdq_u8(a, b), vld1q_u8(tolerance.thresholds + v * 16)));
+  }
+  if (vmaxvq_u8(over) == 0) {
+    return 0;
+  }
+  return diffPixels(p1, p2, s_pixelsPerWord, tolerance);
+}
+
+uint64_t diffWordNeon(const uint8_t *p1, const uint8_t *p2)
+{
+  uint8x16_t equal = vdupq_n_u8(0xFF);
+  for (int v = 0; v < s_bytesPerWord / 16; ++v) {
+    equal = vandq_u8(equal, vceqq_u8(vld1q_u8(p1 + v * 16), vld1q_u8(p2 + v * 16)));
+  }
+  if (vminvq_u8(equal) == 0xFF) {
+    return 0;
+  }
+  return diffPixels(p1, p2, s_pixelsPerWord);
+}
+
+#endif
+
+#if defined(NKAR_X86_KERNELS)
+
+//! Implements the x86 CPU feature detection.
+class Cpu
+{
+public:
+  Cpu()
+  {
+    uint32_t regs[4] = { 0, 0, 0, 0 };
+    if (!cpuid(0, regs)) {
+      return;
+    }
+    const uint32_t maxLeaf = regs[0];
+
+    cpuid(1, regs);
+    m_sse41 = (regs[2] & (1u << 19)) != 0;
+    const bool osxsave = (regs[2] & (1u << 27)) != 0;
+    const bool avx = (regs[2] & (1u << 28)) != 0;
+    if (!osxsave || !avx || maxLeaf < 7) {
+      return;
+    }
+
+    // Check that the OS preserves the vector registers.
+    const uint64_t xcr0 = xgetbv();
+    const bool ymm = (xcr0 & 0x06) == 0x06;
+    const bool zmm = (xcr0 & 0xE6) == 0xE6;
+
+    cpuid(7, regs);
+    m_avx2 = ymm && (regs[1] & (1u << 5)) != 0;
+    m_avx512 = zmm &&
+               (regs[1] & (1u << 16)) != 0 && // AVX512F
+               (regs[1] & (1u << 30)) != 0;   // AVX512BW
+  }
+
+  bool sse41() const
+  {
+    return m_sse41;
+  }
+
+  bool avx2() const
+  {
+    return m_avx2;
+  }
+
+  bool avx512() const
+  {
+    return m_avx512;
+  }
+
+private:
+  static bool cpuid(uint32_t leaf, uint32_t regs[4])
+  {
+#if defined(_MSC_VER)
+    int info[4];
+    __cpuidex(info, (int)leaf, 0);
+    for (int i = 0; i < 4; ++i) {
+      regs[i] = (uint32_t)info[i];
+    }
+    return true;
+#else
+    return __get_cpuid_count(leaf, 0, &regs[0], &regs[1], &regs[2], &regs[3]) != 0;
+#endif
+  }
+
+  static uint64_t xgetbv()
+  {
+#if defined(_MSC_VER)
+    return _xgetbv(0);
+#else
+    uint32_t eax, edx;
+    __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((uint64_t)edx << 32) | eax;
+#endif
+  }
+
+  bool m_sse41{ false };
+  bool m_avx2{ false };
+  bool m_avx512{ false };
+};
+
+#endif
+
+//! Returns the kernel sets supported by the current CPU, the best one first.
+int supportedKernels(const KernelSet *kernels[])
+{
+  int count = 0;
+#if defined(NKAR_X86_KERNELS)
+  const Cpu cpu;
+  if (cpu.avx512()) {
+    kernels[count++] = &avx512;
+  }
+  if (cpu.avx2()) {
+    kernels[count++] = &avx2;
+  }
+  if (cpu.sse41()) {
+    kernels[count++] = &sse41;
+  }
+#elif defined(NKAR_NEON_KERNELS)
+  kernels[count++] = &neon;
+#endif
+  kernels[count++] = &scalar;
+  return count;
+}
+
+const KernelSet &select()
+{
+  const KernelSet *kernels[8];
+  const int count = supportedKernels(kernels);
+
+  const char *name = getenv("NKAR_KERNEL");
+  if (name && *name) {
+    for (int i = 0; i < count; ++i) {
+      if (strcmp(kernels[i]->name, name) == 0) {
+        return *kernels[i];
+      }
+    }
+    fprintf(stderr, "The '%s' kernel set is not supported, '%s' is used instead\n",
+            name, kernels[0]->name);
+  }
+  return *kernels[0];
+}
+
+}
+
+const KernelSet scalar = { "scalar", &diffRow<diffWordScalar>, &diffRow32<diffWord32Scalar>,
+                           &diffRowTolerant<diffWordTolerantScalar, diffWordTolerantScalar>,
+                           &equalScalar, &mergeRow };
+
+#if defined(NKAR_NEON_KERNELS)
+const KernelSet neon = { "neon", &diffRow<diffWordNeon>, &diffRow32<diffWord32Neon>,
+                         &diffRowTolerant<diffWordTolerantNeon<3>, diffWordTolerantNeon<4>>,
+                         &equal<64, equalBlockNeon>, &mergeRow };
+#endif
+
+Tolerance::Tolerance(int bytesPerPixel, int channels, int maxChannelDelta, int maxSumDelta)
+  :
+    bytesPerPixel(bytesPerPixel),
+    channels(channels),
+    maxChannelDelta(maxChannelDelta),
+    maxSumDelta(maxSumDelta),
+    refine(false)
+{
+  int threshold = maxChannelDelta;
+  if (maxSumDelta > 0 && maxSumDelta / channels < maxChannelDelta) {
+    // If the sum of differences exceeds the limit, at least one of the channel
+    // differences exceeds the average.
+    threshold = maxSumDelta / channels;
+    refine = true;
+  }
+
+  for (int i = 0; i < bytesPerPixel * s_pixelsPerWord; ++i) {
+    // The bytes that are not compared never exceed the threshold.
+    thresholds[i] = i % bytesPerPixel < channels ? (uint8_t)threshold : 0xFF;
+  }
+}
+
+const KernelSet &active()
+{
+  static const KernelSet &kernels = select();
+  return kernels;
+}
+
+}
+
+}
@@ -0,0 +1,141 @@
+/**********************************************************************************
+*  MIT License                                                                    *
+*                                                                                 *
+*  Copyright (c) 2022 Vahan Aghajanyan <vahancho@gmail.com>                       *
+*                                                                                 *
+*  Permission is hereby granted, free of charge, to any person obtaining a copy   *
+*  of this software and associated documentation files (the "Software"), to deal  *
+*  in the Software without restriction, including without limitation the rights   *
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+*  copies of the Software, and to permit persons to whom the Software is          *
+*  furnished to do so, subject to the following conditions:                       *
+*                                                                                 *
+*  The above copyright notice and this permission notice shall be included in all *
+*  copies or substantial portions of the Software.                                *
+*                                                                                 *
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+*  SOFTWARE.                                                                      *
+***********************************************************************************/
+
+#ifndef _KERNELS_H_
+#define _KERNELS_H_
+
+#include <cstddef>
+#include <cstdint>
+
+namespace nkar
+{
+
+namespace kernels
+{
+
+//! Compares two scanlines of packed 8-bit RGB pixels.
+/*!
+  Writes one bit per pixel to \p mask, where a set bit means that the pixel
+  differs. The \p mask must hold at least <tt>(width + 63) / 64</tt> words.
+
+  \return true if at least one pixel differs and false otherwise.
+*/
+using DiffRowFunction = bool (*)(const uint8_t *row1, const uint8_t *row2, int width,
+                                 uint64_t *mask);
+
+//! Compares two scanlines of 4-byte pixels.
+/*!
+  A pixel differs if any of its bytes selected by the \p channels mask differs,
+  i.e. the \p channels mask is applied to the pixels as to 32-bit numbers in
+  memory order. Otherwise the same as DiffRowFunction.
+*/
+using DiffRow32Function = bool (*)(const uint8_t *row1, const uint8_t *row2, int width,
+                                   uint32_t channels, uint64_t *mask);
+
+//! Implements the parameters of the tolerant pixel comparison.
+/*!
+  A pixel differs if the absolute difference of any of its channels exceeds
+  \c maxChannelDelta or, if \c maxSumDelta isn't zero, the sum of the absolute
+  differences of all channels exceeds \c maxSumDelta.
+*/
+struct Tolerance
+{
+  //! Initializes the tolerance.
+  /*!
+    \param bytesPerPixel The pixel size, either 3 or 4 bytes
+    \param channels The number of leading bytes of a pixel to compare
+    \param maxChannelDelta The maximum allowed difference of a channel
+    \param maxSumDelta The maximum allowed sum of channel differences or 0
+  */
+  Tolerance(int bytesPerPixel, int channels, int maxChannelDelta, int maxSumDelta);
+
+  int bytesPerPixel;
+  int channels;
+  int maxChannelDelta;
+  int maxSumDelta;
+
+  //! Indicates whether the pixels exceeding thresholds must be checked against all rules.
+  bool refine;
+
+  //! The per byte difference thresholds of 64 pixels for vectorized comparison.
+  /*!
+    A pixel that has no byte exceeding its threshold doesn't differ. When the
+    \c maxSumDelta is used, thresholds are lowered so that pixels with a large
+    sum of differences exceed them too and \c refine is set.
+  */
+  uint8_t thresholds[256];
+};
+
+//! Compares two scanlines with the \p tolerance.
+/*!
+  Otherwise the same as DiffRowFunction.
+*/
+using DiffRowTolerantFunction = bool (*)(const uint8_t *row1, const uint8_t *row2, int width,
+                                         const Tolerance &tolerance, uint64_t *mask);
+
+//! Returns true if \p size bytes of two buffers are equal.
+using EqualFunction = bool (*)(const uint8_t *data1, const uint8_t *data2, size_t size);
+
+//! Merges \p count words of the \p source mask row into the \p target one (bitwise OR).
+using MergeRowFunction = void (*)(uint64_t *target, const uint64_t *source, int count);
+
+//! Implements a set of comparison kernels built for a particular instruction set.
+struct KernelSet
+{
+  const char *name;
+  DiffRowFunction diffRow;
+  DiffRow32Function diffRow32;
+  DiffRowTolerantFunction diffRowTolerant;
+  EqualFunction equal;
+  MergeRowFunction mergeRow;
+};
+
+//! Returns the kernel set selected for the current CPU.
+/*!
+  The selection is made once, at the first call. The best kernel set supported
+  by the CPU is used unless the NKAR_KERNEL environment variable names another
+  supported one.
+*/
+const KernelSet &active();
+
+// Kernel sets built for particular instruction sets. Each one lives in its own
+// translation unit compiled with the corresponding compiler flags.
+extern const KernelSet scalar;
+
+#if defined(NKAR_X86_KERNELS)
+extern const KernelSet sse41;
+extern const KernelSet avx2;
+extern const KernelSet avx512;
+#endif
+
+#if defined(__aarch64__) || defined(_M_ARM64)
+  #define NKAR_NEON_KERNELS
+extern const KernelSet neon;
+#endif
+
+}
+
+}
+
+#endif // _KERNELS_H_
@@ -0,0 +1,130 @@
+/**********************************************************************************
+*  MIT License                                                                    *
+*                                                                                 *
+*  Copyright (c) 2022 Vahan Aghajanyan <vahancho@gmail.com>                       *
+*                                                                                 *
+*  Permission is hereby granted, free of charge, to any person obtaining a copy   *
+*  of this software and associated documentation files (the "Software"), to deal  *
+*  in the Software without restriction, including without limitation the rights   *
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+*  copies of the Software, and to permit persons to whom the Software is          *
+*  furnished to do so, subject to the following conditions:                       *
+*                                                                                 *
+*  The above copyright notice and this permission notice shall be included in all *
+*  copies or substantial portions of the Software.                                *
+*                                                                                 *
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+*  SOFTWARE.                                                                      *
+***********************************************************************************/
+
+// This file is compiled with the AVX2 instruction set enabled.
+
+#include <immintrin.h>
+
+#include "kernels.h"
+#include "kernels_common.h"
+
+namespace nkar
+{
+
+namespace kernels
+{
+
+namespace
+{
+
+bool equalBlockAvx2(const uint8_t *p1, const uint8_t *p2)
+{
+  __m256i diff = _mm256_setzero_si256();
+  for (int v = 0; v < 4; ++v) {
+    const __m256i a = _mm256_loadu_si256((const __m256i *)(p1 + v * 32));
+    const __m256i b = _mm256_loadu_si256((const __m256i *)(p2 + v * 32));
+    diff = _mm256_or_si256(diff, _mm256_xor_si256(a, b));
+  }
+  return _mm256_testz_si256(diff, diff) != 0;
+}
+
+uint64_t diffWordAvx2(const uint8_t *p1, const uint8_t *p2)
+{
+  static constexpr int vectors = s_bytesPerWord / 32;
+
+  __m256i a[vectors];
+  __m256i b[vectors];
+  __m256i diff = _mm256_setzero_si256();
+  for (int v = 0; v < vectors; ++v) {
+    a[v] = _mm256_loadu_si256((const __m256i *)(p1 + v * 32));
+    b[v] = _mm256_loadu_si256((const __m256i *)(p2 + v * 32));
+    diff = _mm256_or_si256(diff, _mm256_xor_si256(a[v], b[v]));
+  }
+  if (_mm256_testz_si256(diff, diff)) {
+    return 0;
+  }
+
+  uint64_t bytes[s_bytesPerPixel] = { 0, 0, 0 };
+  for (int v = 0; v < vectors; ++v) {
+    const uint32_t equal = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a[v], b[v]));
+    bytes[v / 2] |= (uint64_t)(~equal) << (32 * (v % 2));
+  }
+  return foldBytes<s_bytesPerPixel>(bytes);
+}
+
+uint64_t diffWord32Avx2(const uint8_t *p1, const uint8_t *p2, uint32_t channels)
+{
+  const __m256i mask = _mm256_set1_epi32((int)channels);
+  const __m256i zero = _mm256_setzero_si256();
+
+  uint64_t word = 0;
+  for (int v = 0; v < s_pixelsPerWord / 8; ++v) {
+    const __m256i a = _mm256_loadu_si256((const __m256i *)(p1 + v * 32));
+    const __m256i b = _mm256_loadu_si256((const __m256i *)(p2 + v * 32));
+    const __m256i diff = _mm256_and_si256(_mm256_xor_si256(a, b), mask);
+    const unsigned equal =
+      (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(diff, zero)));
+    word |= (uint64_t)(~equal & 0xFF) << (8 * v);
+  }
+  return word;
+}
+
+template <int Bpp>
+uint64_t diffWordTolerantAvx2(const uint8_t *p1, const uint8_t *p2, const Tolerance &tolerance)
+{
+  static constexpr int vectors = s_pixelsPerWord * Bpp / 32;
+
+  // The byte differences exceeding thresholds.
+  __m256i over[vectors];
+  __m256i any = _mm256_setzero_si256();
+  for (int v = 0; v < vectors; ++v) {
+    const __m256i a = _mm256_loadu_si256((const __m256i *)(p1 + v * 32));
+    const __m256i b = _mm256_loadu_si256((const __m256i *)(p2 + v * 32));
+    const __m256i t = _mm256_loadu_si256((const __m256i *)(tolerance.thresholds + v * 32));
+    const __m256i delta = _mm256_or_si256(_mm256_subs_epu8(a, b), _mm256_subs_epu8(b, a));
+    over[v] = _mm256_subs_epu8(delta, t);
+    any = _mm256_or_si256(any, over[v]);
+  }
+  if (_mm256_testz_si256(any, any)) {
+    return 0;
+  }
+
+  const __m256i zero = _mm256_setzero_si256();
+  uint64_t bytes[Bpp] = {};
+  for (int v = 0; v < vectors; ++v) {
+    const uint32_t equal = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(over[v], zero));
+    bytes[v / 2] |= (uint64_t)(~equal) << (32 * (v % 2));
+  }
+  return foldBytes<Bpp>(bytes);
+}
+
+}
+
+const KernelSet avx2 = { "avx2", &diffRow<diffWordAvx2>, &diffRow32<diffWord32Avx2>,
+                         &diffRowTolerant<diffWordTolerantAvx2<3>, diffWordTolerantAvx2<4>>,
+                         &equal<128, equalBlockAvx2>, &mergeRow };
+
+}
+
+}
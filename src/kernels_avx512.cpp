@@ -0,0 +1,112 @@
+/**********************************************************************************
+*  MIT License                                                                    *
+*                                                                                 *
+*  Copyright (c) 2022 Vahan Aghajanyan <vahancho@gmail.com>                       *
+*                                                                                 *
+*  Permission is hereby granted, free of charge, to any person obtaining a copy   *
+*  of this software and associated documentation files (the "Software"), to deal  *
+*  in the Software without restriction, including without limitation the rights   *
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+*  copies of the Software, and to permit persons to whom the Software is          *
+*  furnished to do so, subject to the following conditions:                       *
+*                                                                                 *
+*  The above copyright notice and this permission notice shall be included in all *
+*  copies or substantial portions of the Software.                                *
+*                                                                                 *
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+*  SOFTWARE.                                                                      *
+***********************************************************************************/
+
+// This file is compiled with the AVX-512 (F and BW) instruction set enabled.
+
+#include <immintrin.h>
+
+#include "kernels.h"
+#include "kernels_common.h"
+
+namespace nkar
+{
+
+namespace kernels
+{
+
+namespace
+{
+
+bool equalBlockAvx512(const uint8_t *p1, const uint8_t *p2)
+{
+  __m512i diff = _mm512_setzero_si512();
+  for (int v = 0; v < 4; ++v) {
+    const __m512i a = _mm512_loadu_si512((const void *)(p1 + v * 64));
+    const __m512i b = _mm512_loadu_si512((const void *)(p2 + v * 64));
+    diff = _mm512_or_si512(diff, _mm512_xor_si512(a, b));
+  }
+  return _mm512_test_epi64_mask(diff, diff) == 0;
+}
+
+uint64_t diffWordAvx512(const uint8_t *p1, const uint8_t *p2)
+{
+  static constexpr int vectors = s_bytesPerWord / 64;
+
+  uint64_t bytes[s_bytesPerPixel];
+  uint64_t any = 0;
+  for (int v = 0; v < vectors; ++v) {
+    const __m512i a = _mm512_loadu_si512((const void *)(p1 + v * 64));
+    const __m512i b = _mm512_loadu_si512((const void *)(p2 + v * 64));
+    bytes[v] = (uint64_t)_mm512_cmpneq_epi8_mask(a, b);
+    any |= bytes[v];
+  }
+  if (any == 0) {
+    return 0;
+  }
+  return foldBytes<s_bytesPerPixel>(bytes);
+}
+
+uint64_t diffWord32Avx512(const uint8_t *p1, const uint8_t *p2, uint32_t channels)
+{
+  const __m512i mask = _mm512_set1_epi32((int)channels);
+
+  uint64_t word = 0;
+  for (int v = 0; v < s_pixelsPerWord / 16; ++v) {
+    const __m512i a = _mm512_loadu_si512((const void *)(p1 + v * 64));
+    const __m512i b = _mm512_loadu_si512((const void *)(p2 + v * 64));
+    const uint64_t diff = (uint64_t)_mm512_test_epi32_mask(_mm512_xor_si512(a, b), mask);
+    word |= diff << (16 * v);
+  }
+  return word;
+}
+
+template <int Bpp>
+uint64_t diffWordTolerantAvx512(const uint8_t *p1, const uint8_t *p2, const Tolerance &tolerance)
+{
+  uint64_t bytes[Bpp];
+  uint64_t any = 0;
+  for (int v = 0; v < Bpp; ++v) {
+    const __m512i a = _mm512_loadu_si512((const void *)(p1 + v * 64));
+    const __m512i b = _mm512_loadu_si512((const void *)(p2 + v * 64));
+    const __m512i t = _mm512_loadu_si512((const void *)(tolerance.thresholds + v * 64));
+    const __m512i delta = _mm512_or_si512(_mm512_subs_epu8(a, b), _mm512_subs_epu8(b, a));
+    const __m512i over = _mm512_subs_epu8(delta, t);
+    bytes[v] = (uint64_t)_mm512_test_epi8_mask(over, over);
+    any |= bytes[v];
+  }
+  if (any == 0) {
+    return 0;
+  }
+  return foldBytes<Bpp>(bytes);
+}
+
+}
+
+const KernelSet avx512 = { "avx512", &diffRow<diffWordAvx512>, &diffRow32<diffWord32Avx512>,
+                           &diffRowTolerant<diffWordTolerantAvx512<3>, diffWordTolerantAvx512<4>>,
+                           &equal<256, equalBlockAvx512>, &mergeRow };
+
+}
+
+}
@@ -0,0 +1,280 @@
+/**********************************************************************************
+*  MIT License                                                                    *
+*                                                                                 *
+*  Copyright (c) 2022 Vahan Aghajanyan <vahancho@gmail.com>                       *
+*                                                                                 *
+*  Permission is hereby granted, free of charge, to any person obtaining a copy   *
+*  of this software and associated documentation files (the "Software"), to deal  *
+*  in the Software without restriction, including without limitation the rights   *
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+*  copies of the Software, and to permit persons to whom the Software is          *
+*  furnished to do so, subject to the following conditions:                       *
+*                                                                                 *
+*  The above copyright notice and this permission notice shall be included in all *
+*  copies or substantial portions of the Software.                                *
+*                                                                                 *
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+*  SOFTWARE.                                                                      *
+***********************************************************************************/
+
+#ifndef _KERNELS_COMMON_H_
+#define _KERNELS_COMMON_H_
+
+// The building blocks shared by the kernel sets. Everything here has internal
+// linkage on purpose: each kernel set is compiled with its own instruction set
+// flags and the linker must never substitute one copy of a function for another.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(_MSC_VER)
+  #include <intrin.h>
+#endif
+
+#include "kernels.h"
+
+namespace nkar
+{
+
+namespace kernels
+{
+
+namespace
+{
+
+// The number of bytes per RGB pixel.
+constexpr int s_bytesPerPixel = 3;
+
+// The number of pixels that fit in one word of a difference mask.
+constexpr int s_pixelsPerWord = 64;
+
+// The number of bytes of s_pixelsPerWord pixels.
+constexpr int s_bytesPerWord = s_pixelsPerWord * s_bytesPerPixel;
+
+// Returns the index of the lowest set bit of a non-zero word.
+inline int firstBit(uint64_t word)
+{
+#if defined(_MSC_VER)
+  unsigned long idx;
+  if (_BitScanForward(&idx, (unsigned long)word)) {
+    return (int)idx;
+  }
+  _BitScanForward(&idx, (unsigned long)(word >> 32));
+  return (int)idx + 32;
+#else
+  return __builtin_ctzll(word);
+#endif
+}
+
+// Compares up to 64 pixels one by one and returns their difference bits.
+inline uint64_t diffPixels(const uint8_t *p1, const uint8_t *p2, int count)
+{
+  uint64_t word = 0;
+  for (int i = 0; i < count; ++i, p1 += s_bytesPerPixel, p2 += s_bytesPerPixel) {
+    if (p1[0] != p2[0] || p1[1] != p2[1] || p1[2] != p2[2]) {
+      word |= uint64_t(1) << i;
+    }
+  }
+  return word;
+}
+
+// Converts the bits of differing bytes of 64 pixels of Bpp bytes into the pixel
+// difference bits.
+template <int Bpp>
+inline uint64_t foldBytes(const uint64_t bytes[Bpp])
+{
+  uint64_t word = 0;
+  for (int i = 0; i < Bpp; ++i) {
+    uint64_t bits = bytes[i];
+    while (bits) {
+      const int byte = i * 64 + firstBit(bits);
+      word |= uint64_t(1) << (byte / Bpp);
+      bits &= bits - 1;
+    }
+  }
+  return word;
+}
+
+// Returns true if two pixels differ more than the tolerance allows.
+inline bool pixelDiffers(const uint8_t *p1, const uint8_t *p2, const Tolerance &tolerance)
+{
+  int sum = 0;
+  for (int c = 0; c < tolerance.channels; ++c) {
+    const int delta = p1[c] > p2[c] ? p1[c] - p2[c] : p2[c] - p1[c];
+    if (delta > tolerance.maxChannelDelta) {
+      return true;
+    }
+    sum += delta;
+  }
+  return tolerance.maxSumDelta > 0 && sum > tolerance.maxSumDelta;
+}
+
+// Compares up to 64 pixels with the tolerance one by one and returns their difference bits.
+inline uint64_t diffPixels(const uint8_t *p1, const uint8_t *p2, int count,
+                           const Tolerance &tolerance)
+{
+  const int bpp = tolerance.bytesPerPixel;
+  uint64_t word = 0;
+  for (int i = 0; i < count; ++i, p1 += bpp, p2 += bpp) {
+    if (pixelDiffers(p1, p2, tolerance)) {
+      word |= uint64_t(1) << i;
+    }
+  }
+  return word;
+}
+
+// Re-checks the pixels of the \p word, that exceed the candidate thresholds, against
+// the full tolerance rules.
+inline uint64_t refinePixels(const uint8_t *p1, const uint8_t *p2, uint64_t word,
+                             const Tolerance &tolerance)
+{
+  const int bpp = tolerance.bytesPerPixel;
+  uint64_t bits = word;
+  while (bits) {
+    const int i = firstBit(bits);
+    bits &= bits - 1;
+    if (!pixelDiffers(p1 + i * bpp, p2 + i * bpp, tolerance)) {
+      word &= ~(uint64_t(1) << i);
+    }
+  }
+  return word;
+}
+
+// Compares two rows word by word with the given 64 pixel comparison function.
+template <uint64_t (*DiffWord)(const uint8_t *, const uint8_t *)>
+inline bool diffRow(const uint8_t *row1, const uint8_t *row2, int width, uint64_t *mask)
+{
+  uint64_t any = 0;
+  int x = 0;
+  for (; x + s_pixelsPerWord <= width; x += s_pixelsPerWord) {
+    const uint64_t word = DiffWord(row1, row2);
+    *mask++ = word;
+    any |= word;
+    row1 += s_bytesPerWord;
+    row2 += s_bytesPerWord;
+  }
+
+  if (x < width) {
+    const uint64_t word = diffPixels(row1, row2, width - x);
+    *mask = word;
+    any |= word;
+  }
+
+  return any != 0;
+}
+
+// Compares up to 64 pixels of 4 bytes one by one and returns their difference bits.
+inline uint64_t diffPixels32(const uint8_t *p1, const uint8_t *p2, uint32_t channels, int count)
+{
+  uint64_t word = 0;
+  for (int i = 0; i < count; ++i, p1 += 4, p2 += 4) {
+    uint32_t a, b;
+    memcpy(&a, p1, 4);
+    memcpy(&b, p2, 4);
+    if ((a ^ b) & channels) {
+      word |= uint64_t(1) << i;
+    }
+  }
+  return word;
+}
+
+// Compares two rows of 4-byte pixels word by word with the given 64 pixel
+// comparison function.
+template <uint64_t (*DiffWord32)(const uint8_t *, const uint8_t *, uint32_t)>
+inline bool diffRow32(const uint8_t *row1, const uint8_t *row2, int width, uint32_t channels,
+                      uint64_t *mask)
+{
+  uint64_t any = 0;
+  int x = 0;
+  for (; x + s_pixelsPerWord <= width; x += s_pixelsPerWord) {
+    const uint64_t word = DiffWord32(row1, row2, channels);
+    *mask++ = word;
+    any |= word;
+    row1 += s_pixelsPerWord * 4;
+    row2 += s_pixelsPerWord * 4;
+  }
+
+  if (x < width) {
+    const uint64_t word = diffPixels32(row1, row2, channels, width - x);
+    *mask = word;
+    any |= word;
+  }
+
+  return any != 0;
+}
+
+// Compares two rows with the tolerance word by word with the given 64 pixel
+// comparison function.
+template <int Bpp, uint64_t (*DiffWord)(const uint8_t *, const uint8_t *, const Tolerance &)>
+inline bool diffRowTolerant(const uint8_t *row1, const uint8_t *row2, int width,
+                            const Tolerance &tolerance, uint64_t *mask)
+{
+  uint64_t any = 0;
+  int x = 0;
+  for (; x + s_pixelsPerWord <= width; x += s_pixelsPerWord) {
+    uint64_t word = DiffWord(row1, row2, tolerance);
+    if (word && tolerance.refine) {
+      word = refinePixels(row1, row2, word, tolerance);
+    }
+    *mask++ = word;
+    any |= word;
+    row1 += s_pixelsPerWord * Bpp;
+    row2 += s_pixelsPerWord * Bpp;
+  }
+
+  if (x < width) {
+    const uint64_t word = diffPixels(row1, row2, width - x, tolerance);
+    *mask = word;
+    any |= word;
+  }
+
+  return any != 0;
+}
+
+// Selects the tolerant row comparison function for the number of bytes per pixel.
+template <uint64_t (*DiffWord3)(const uint8_t *, const uint8_t *, const Tolerance &),
+          uint64_t (*DiffWord4)(const uint8_t *, const uint8_t *, const Tolerance &)>
+inline bool diffRowTolerant(const uint8_t *row1, const uint8_t *row2, int width,
+                            const Tolerance &tolerance, uint64_t *mask)
+{
+  if (tolerance.bytesPerPixel == 3) {
+    return diffRowTolerant<3, DiffWord3>(row1, row2, width, tolerance, mask);
+  }
+  return diffRowTolerant<4, DiffWord4>(row1, row2, width, tolerance, mask);
+}
+
+// Compares buffers in blocks of Block bytes with the given block comparison
+// function that returns true if blocks are equal.
+template <size_t Block, bool (*EqualBlock)(const uint8_t *, const uint8_t *)>
+inline bool equal(const uint8_t *data1, const uint8_t *data2, size_t size)
+{
+  size_t offset = 0;
+  for (; offset + Block <= size; offset += Block) {
+    if (!EqualBlock(data1 + offset, data2 + offset)) {
+      return false;
+    }
+  }
+  return memcmp(data1 + offset, data2 + offset, size - offset) == 0;
+}
+
+// The plain loop is vectorized by the compiler for the target instruction set.
+inline void mergeRow(uint64_t *target, const uint64_t *source, int count)
+{
+  for (int i = 0; i < count; ++i) {
+    target[i] |= source[i];
+  }
+}
+
+}
+
+}
+
+}
+
+#endif // _KERNELS_COMMON_H_
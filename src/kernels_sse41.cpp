@@ -0,0 +1,130 @@
+/**********************************************************************************
+*  MIT License                                                                    *
+*                                                                                 *
+*  Copyright (c) 2022 Vahan Aghajanyan <vahancho@gmail.com>                       *
+*                                                                                 *
+*  Permission is hereby granted, free of charge, to any person obtaining a copy   *
+*  of this software and associated documentation files (the "Software"), to deal  *
+*  in the Software without restriction, including without limitation the rights   *
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+*  copies of the Software, and to permit persons to whom the Software is          *
+*  furnished to do so, subject to the following conditions:                       *
+*                                                                                 *
+*  The above copyright notice and this permission notice shall be included in all *
+*  copies or substantial portions of the Software.                                *
+*                                                                                 *
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+*  SOFTWARE.                                                                      *
+***********************************************************************************/
+
+// This file is compiled with the SSE4.1 instruction set enabled.
+
+#include <smmintrin.h>
+
+#include "kernels.h"
+#include "kernels_common.h"
+
+namespace nkar
+{
+
+namespace kernels
+{
+
+namespace
+{
+
+bool equalBlockSse41(const uint8_t *p1, const uint8_t *p2)
+{
+  __m128i diff = _mm_setzero_si128();
+  for (int v = 0; v < 4; ++v) {
+    const __m128i a = _mm_loadu_si128((const __m128i *)(p1 + v * 16));
+    const __m128i b = _mm_loadu_si128((const __m128i *)(p2 + v * 16));
+    diff = _mm_or_si128(diff, _mm_xor_si128(a, b));
+  }
+  return _mm_testz_si128(diff, diff) != 0;
+}
+
+uint64_t diffWordSse41(const uint8_t *p1, const uint8_t *p2)
+{
+  static constexpr int vectors = s_bytesPerWord / 16;
+
+  __m128i a[vectors];
+  __m128i b[vectors];
+  __m128i diff = _mm_setzero_si128();
+  for (int v = 0; v < vectors; ++v) {
+    a[v] = _mm_loadu_si128((const __m128i *)(p1 + v * 16));
+    b[v] = _mm_loadu_si128((const __m128i *)(p2 + v * 16));
+    diff = _mm_or_si128(diff, _mm_xor_si128(a[v], b[v]));
+  }
+  if (_mm_testz_si128(diff, diff)) {
+    return 0;
+  }
+
+  uint64_t bytes[s_bytesPerPixel] = { 0, 0, 0 };
+  for (int v = 0; v < vectors; ++v) {
+    const unsigned equal = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(a[v], b[v]));
+    bytes[v / 4] |= (uint64_t)(~equal & 0xFFFF) << (16 * (v % 4));
+  }
+  return foldBytes<s_bytesPerPixel>(bytes);
+}
+
+uint64_t diffWord32Sse41(const uint8_t *p1, const uint8_t *p2, uint32_t channels)
+{
+  const __m128i mask = _mm_set1_epi32((int)channels);
+  const __m128i zero = _mm_setzero_si128();
+
+  uint64_t word = 0;
+  for (int v = 0; v < s_pixelsPerWord / 4; ++v) {
+    const __m128i a = _mm_loadu_si128((const __m128i *)(p1 + v * 16));
+    const __m128i b = _mm_loadu_si128((const __m128i *)(p2 + v * 16));
+    const __m128i diff = _mm_and_si128(_mm_xor_si128(a, b), mask);
+    const unsigned equal =
+      (unsigned)_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(diff, zero)));
+    word |= (uint64_t)(~equal & 0xF) << (4 * v);
+  }
+  return word;
+}
+
+template <int Bpp>
+uint64_t diffWordTolerantSse41(const uint8_t *p1, const uint8_t *p2, const Tolerance &tolerance)
+{
+  static constexpr int vectors = s_pixelsPerWord * Bpp / 16;
+
+  // The byte differences exceeding thresholds.
+  __m128i over[vectors];
+  __m128i any = _mm_setzero_si128();
+  for (int v = 0; v < vectors; ++v) {
+    const __m128i a = _mm_loadu_si128((const __m128i *)(p1 + v * 16));
+    const __m128i b = _mm_loadu_si128((const __m128i *)(p2 + v * 16));
+    const __m128i t = _mm_loadu_si128((const __m128i *)(tolerance.thresholds + v * 16));
+    const __m128i delta = _mm_or_si128(_mm_subs_epu8(a, b), _mm_subs_epu8(b, a));
+    over[v] = _mm_subs_epu8(delta, t);
+    any = _mm_or_si128(any, over[v]);
+  }
+  if (_mm_testz_si128(any, any)) {
+    return 0;
+  }
+
+  const __m128i zero = _mm_setzero_si128();
+  uint64_t bytes[Bpp] = {};
+  for (int v = 0; v < vectors; ++v) {
+    const unsigned equal = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(over[v], zero));
+    bytes[v / 4] |= (uint64_t)(~equal & 0xFFFF) << (16 * (v % 4));
+  }
+  return foldBytes<Bpp>(bytes);
+}
+
+}
+
+const KernelSet sse41 = { "sse4.1", &diffRow<diffWordSse41>, &diffRow32<diffWord32Sse41>,
+                          &diffRowTolerant<diffWordTolerantSse41<3>, diffWordTolerantSse41<4>>,
+                          &equal<64, equalBlockSse41>, &mergeRow };
+
+}
+
+}
@@ -0,0 +1,164 @@
+/**********************************************************************************
+*  MIT License                                                                    *
+*                                                                                 *
+*  Copyright (c) 2022 Vahan Aghajanyan <vahancho@gmail.com>                       *
+*                                                                                 *
+*  Permission is hereby granted, free of charge, to any person obtaining a copy   *
+*  of this software and associated documentation files (the "Software"), to deal  *
+*  in the Software without restriction, including without limitation the rights   *
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+*  copies of the Software, and to permit persons to whom the Software is          *
+*  furnished to do so, subject to the following conditions:                       *
+*                                                                                 *
+*  The above copyright notice and this permission notice shall be included in all *
+*  copies or substantial portions of the Software.                                *
+*                                                                                 *
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+*  SOFTWARE.                                                                      *
+***********************************************************************************/
+
+#include <algorithm>
+
+#include "options.h"
+
+namespace nkar
+{
+
+Options::Options()
+  :
+    m_highlightColor(255, 0, 0),
+    m_threadCount(1),
+    m_maxChannelDelta(0),
+    m_maxSumDelta(0),
+    m_blockWidth(1),
+    m_blockHeight(1),
+    m_mergeRadius(0),
+    m_minComponentArea(0),
+    m_maxDifferentPixels(0),
+    m_maxContours(0),
+    m_simplificationTolerance(0),
+    m_boundingBoxesOnly(false)
+{}
+
+const Color &Options::highlightColor() const
+{
+  return m_highlightColor;
+}
+
+void Options::setHighlightColor(const Color &color)
+{
+  m_highlightColor = color;
+}
+
+int Options::threadCount() const
+{
+  return m_threadCount;
+}
+
+void Options::setThreadCount(int count)
+{
+  m_threadCount = count;
+}
+
+int Options::maxChannelDelta() const
+{
+  return m_maxChannelDelta;
+}
+
+void Options::setMaxChannelDelta(int delta)
+{
+  m_maxChannelDelta = std::min(std::max(delta, 0), 255);
+}
+
+int Options::maxSumDelta() const
+{
+  return m_maxSumDelta;
+}
+
+void Options::setMaxSumDelta(int delta)
+{
+  m_maxSumDelta = std::max(delta, 0);
+}
+
+int Options::blockWidth() const
+{
+  return m_blockWidth;
+}
+
+int Options::blockHeight() const
+{
+  return m_blockHeight;
+}
+
+void Options::setBlockSize(int width, int height)
+{
+  m_blockWidth = std::max(width, 1);
+  m_blockHeight = std::max(height, 1);
+}
+
+int Options::mergeRadius() const
+{
+  return m_mergeRadius;
+}
+
+void Options::setMergeRadius(int radius)
+{
+  m_mergeRadius = std::max(radius, 0);
+}
+
+size_t Options::minComponentArea() const
+{
+  return m_minComponentArea;
+}
+
+void Options::setMinComponentArea(size_t area)
+{
+  m_minComponentArea = area;
+}
+
+size_t Options::maxDifferentPixels() const
+{
+  return m_maxDifferentPixels;
+}
+
+void Options::setMaxDifferentPixels(size_t count)
+{
+  m_maxDifferentPixels = count;
+}
+
+size_t Options::maxContours() const
+{
+  return m_maxContours;
+}
+
+void Options::setMaxContours(size_t count)
+{
+  m_maxContours = count;
+}
+
+double Options::simplificationTolerance() const
+{
+  return m_simplificationTolerance;
+}
+
+void Options::setSimplificationTolerance(double tolerance)
+{
+  m_simplificationTolerance = tolerance;
+}
+
+bool Options::boundingBoxesOnly() const
+{
+  return m_boundingBoxesOnly;
+}
+
+void Options::setBoundingBoxesOnly(bool enabled)
+{
+  m_boundingBoxesOnly = enabled;
+}
+
+}
@@ -0,0 +1,196 @@
+/**********************************************************************************
+*  MIT License                                                                    *
+*                                                                                 *
+*  Copyright (c) 2022 Vahan Aghajanyan <vahancho@gmail.com>                       *
+*                                                                                 *
+*  Permission is hereby granted, free of charge, to any person obtaining a copy   *
+*  of this software and associated documentation files (the "Software"), to deal  *
+*  in the Software without restriction, including without limitation the rights   *
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+*  copies of the Software, and to permit persons to whom the Software is          *
+*  furnished to do so, subject to the following conditions:                       *
+*                                                                                 *
+*  The above copyright notice and this permission notice shall be included in all *
+*  copies or substantial portions of the Software.                                *
+*                                                                                 *
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+*  SOFTWARE.                                                                      *
+***********************************************************************************/
+
+#ifndef _OPTIONS_H_
+#define _OPTIONS_H_
+
+#include <cstddef>
+
+#include "color.h"
+#include "export.h"
+
+namespace nkar
+{
+
+//! Implements the image comparison options.
+class NKAR_EXPORT Options
+{
+public:
+  //! Constructs the default comparison options.
+  Options();
+
+  //! Returns the color of the difference outlines. Default color is red.
+  const Color &highlightColor() const;
+
+  //! Sets the color of the difference outlines.
+  void setHighlightColor(const Color &color);
+
+  //! Returns the number of threads used for the comparison.
+  int threadCount() const;
+
+  //! Sets the number of threads used for the comparison.
+  /*!
+    The images are split into horizontal bands that are compared in parallel.
+    The default value 1 means that the comparison runs on the calling thread
+    only. The value 0 means that all hardware threads are used. At most 64 bands
+    are processed in parallel.
+  */
+  void setThreadCount(int count);
+
+  //! Returns the maximum allowed difference of a pixel channel.
+  int maxChannelDelta() const;
+
+  //! Sets the maximum allowed difference of a pixel channel.
+  /*!
+    Pixels are considered equal if the absolute difference of each of their
+    channels doesn't exceed \p delta. This allows ignoring the noise of lossy
+    compression or color dithering. The default value 0 means exact comparison.
+    The value is clamped to the [0, 255] range.
+  */
+  void setMaxChannelDelta(int delta);
+
+  //! Returns the maximum allowed sum of differences of pixel channels.
+  int maxSumDelta() const;
+
+  //! Sets the maximum allowed sum of differences of pixel channels.
+  /*!
+    Pixels, that are equal according to the maxChannelDelta(), are still
+    considered different if the sum of absolute differences of their channels
+    exceeds \p delta. The default value 0 disables this check.
+  */
+  void setMaxSumDelta(int delta);
+
+  //! Returns the width of the comparison block.
+  int blockWidth() const;
+
+  //! Returns the height of the comparison block.
+  int blockHeight() const;
+
+  //! Sets the size of the comparison block.
+  /*!
+    The differences are outlined with the precision of blocks: a block that has
+    at least one different pixel is entirely marked as different. The default
+    1x1 block gives pixel precise contours, while larger blocks produce coarser
+    contours with much less edges and so are faster for massive differences.
+    Both dimensions are clamped to be at least one.
+  */
+  void setBlockSize(int width, int height);
+
+  //! Returns the radius, that dirty blocks are grown by to merge nearby differences.
+  int mergeRadius() const;
+
+  //! Sets the radius, that dirty blocks are grown by to merge nearby differences.
+  /*!
+    Before the contours are found, each dirty block makes dirty all blocks within
+    \p radius blocks from it horizontally and vertically. So the differences, that
+    are separated by up to 2 * \p radius clean blocks, are outlined as one contour
+    enclosing them all, e.g. the changes of anti-aliased glyphs of a word. The
+    default value 0 disables merging. Negative values are clamped to zero. Radii
+    larger than the number of blocks in a row or a column merge all differences, so
+    the comparison limits them to that number.
+  */
+  void setMergeRadius(int radius);
+
+  //! Returns the minimum number of different pixels of a reported component.
+  size_t minComponentArea() const;
+
+  //! Sets the minimum number of different pixels of a reported component.
+  /*!
+    The components - groups of different blocks, that touch each other at least by
+    corners - with less than \p area different pixels are dropped, once their pixels
+    are counted, so isolated specks of noise are neither outlined nor reported. If all
+    components are dropped, the images are considered identical, otherwise the
+    difference mask still contains the pixels of the dropped components. The default
+    value 0 keeps all components.
+  */
+  void setMinComponentArea(size_t area);
+
+  //! Returns the maximum number of different pixels the comparison looks for.
+  size_t maxDifferentPixels() const;
+
+  //! Sets the maximum number of different pixels the comparison looks for.
+  /*!
+    Once more than \p count pixels are found different, the comparison stops and
+    returns a truncated result without contours and the result image. This caps the
+    comparison time of images, that are different entirely. The default value 0 means
+    no limit.
+  */
+  void setMaxDifferentPixels(size_t count);
+
+  //! Returns the maximum number of difference contours the comparison outlines.
+  size_t maxContours() const;
+
+  //! Sets the maximum number of difference contours the comparison outlines.
+  /*!
+    If more than \p count contours are found, the comparison returns a truncated
+    result with only the first \p count contours outlined and returned as polygons,
+    or bounding boxes in the bounding box mode. The limit truncates the output only:
+    all contours are still labelled, so it doesn't shorten the comparison. The default
+    value 0 means no limit.
+  */
+  void setMaxContours(size_t count);
+
+  //! Returns the tolerance of simplification of the contour polygons in pixels.
+  double simplificationTolerance() const;
+
+  //! Sets the tolerance of simplification of the contour polygons in pixels.
+  /*!
+    The polygons returned by Result::contours() are simplified, so that none of the
+    removed vertices is farther than \p tolerance pixels from the simplified outline
+    (see Contours::simplify()). The outlines drawn on the result image are not
+    affected. The default value 0 disables simplification.
+  */
+  void setSimplificationTolerance(double tolerance);
+
+  //! Returns true if the comparison looks for bounding boxes of the differences only.
+  bool boundingBoxesOnly() const;
+
+  //! Sets whether the comparison looks for bounding boxes of the differences only.
+  /*!
+    In this mode the images are compared in a single pass, that keeps only a few
+    rows of the difference data, and the comparison result contains only the
+    bounding boxes of groups of different blocks (see Result::boundingBoxes()).
+    Neither contours nor the result image are built, so the memory usage doesn't
+    depend on the images height. It's disabled by default.
+  */
+  void setBoundingBoxesOnly(bool enabled);
+
+private:
+  Color m_highlightColor;
+  int m_threadCount;
+  int m_maxChannelDelta;
+  int m_maxSumDelta;
+  int m_blockWidth;
+  int m_blockHeight;
+  int m_mergeRadius;
+  size_t m_minComponentArea;
+  size_t m_maxDifferentPixels;
+  size_t m_maxContours;
+  double m_simplificationTolerance;
+  bool m_boundingBoxesOnly;
+};
+
+}
+
+#endif // _OPTIONS_H_
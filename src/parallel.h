@@ -0,0 +1,113 @@
+/**********************************************************************************
+*  MIT License                                                                    *
+*                                                                                 *
+*  Copyright (c) 2022 Vahan Aghajanyan <vahancho@gmail.com>                       *
+*                                                                                 *
+*  Permission is hereby granted, free of charge, to any person obtaining a copy   *
+*  of this software and associated documentation files (the "Software"), to deal  *
+*  in the Software without restriction, including without limitation the rights   *
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+*  copies of the Software, and to permit persons to whom the Software is          *
+*  furnished to do so, subject to the following conditions:                       *
+*                                                                                 *
+*  The above copyright notice and this permission notice shall be included in all *
+*  copies or substantial portions of the Software.                                *
+*                                                                                 *
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+*  SOFTWARE.                                                                      *
+***********************************************************************************/
+
+#ifndef _PARALLEL_H_
+#define _PARALLEL_H_
+
+#include <algorithm>
+#include <exception>
+#include <thread>
+#include <vector>
+
+namespace nkar
+{
+
+//! Returns the number of threads to use for the requested \p threadCount.
+/*!
+  Zero stands for all hardware threads.
+*/
+inline int effectiveThreadCount(int threadCount)
+{
+  if (threadCount > 0) {
+    return threadCount;
+  }
+  return std::max(1, (int)std::thread::hardware_concurrency());
+}
+
+//! The maximum number of bands, that are processed in parallel.
+static const int s_maxBands = 64;
+
+//! Returns the number of bands the range of \p count items is split into.
+inline int bandCount(int count, int threadCount)
+{
+  return std::max(1, std::min(std::min(threadCount, count), s_maxBands));
+}
+
+//! Splits the range [0, count) into consecutive bands and processes them in parallel.
+/*!
+  Calls \p function(band, begin, end) for each band. The first band is processed
+  on the calling thread and each other band on its own thread. The function
+  returns when all bands are processed.
+
+  The started threads are joined on any exit, e.g. if a thread can't be started.
+  If bands throw exceptions, the exception of the first of them is rethrown, once
+  all bands are finished.
+*/
+template <typename Function>
+void forEachBand(int count, int threadCount, const Function &function)
+{
+  const int bands = bandCount(count, threadCount);
+
+  std::vector<std::exception_ptr> errors(bands);
+  auto process = [&](int band) {
+    try {
+      function(band, (int)((long long)count * band / bands),
+               (int)((long long)count * (band + 1) / bands));
+    } catch (...) {
+      errors[band] = std::current_exception();
+    }
+  };
+
+  // Joins the started threads.
+  struct Workers
+  {
+    ~Workers()
+    {
+      for (auto &thread : threads) {
+        thread.join();
+      }
+    }
+
+    std::vector<std::thread> threads;
+  };
+
+  {
+    Workers workers;
+    workers.threads.reserve(bands - 1);
+    for (int band = 1; band < bands; ++band) {
+      workers.threads.emplace_back(process, band);
+    }
+    process(0);
+  }
+
+  for (const auto &error : errors) {
+    if (error) {
+      std::rethrow_exception(error);
+    }
+  }
+}
+
+}
+
+#endif // _PARALLEL_H_
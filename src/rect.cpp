@@ -0,0 +1,84 @@
+/**********************************************************************************
+*  MIT License                                                                    *
+*                                                                                 *
+*  Copyright (c) 2022 Vahan Aghajanyan <vahancho@gmail.com>                       *
+*                                                                                 *
+*  Permission is hereby granted, free of charge, to any person obtaining a copy   *
+*  of this software and associated documentation files (the "Software"), to deal  *
+*  in the Software without restriction, including without limitation the rights   *
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+*  copies of the Software, and to permit persons to whom the Software is          *
+*  furnished to do so, subject to the following conditions:                       *
+*                                                                                 *
+*  The above copyright notice and this permission notice shall be included in all *
+*  copies or substantial portions of the Software.                                *
+*                                                                                 *
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+*  SOFTWARE.                                                                      *
+***********************************************************************************/
+
+#include "rect.h"
+
+namespace nkar
+{
+
+Rect::Rect(int x, int y, int width, int height)
+  :
+    m_x(x),
+    m_y(y),
+    m_width(width),
+    m_height(height)
+{}
+
+bool Rect::operator==(const Rect &other) const
+{
+  return m_x == other.m_x && m_y == other.m_y &&
+         m_width == other.m_width && m_height == other.m_height;
+}
+
+int Rect::x() const
+{
+  return m_x;
+}
+
+int Rect::y() const
+{
+  return m_y;
+}
+
+int Rect::width() const
+{
+  return m_width;
+}
+
+int Rect::height() const
+{
+  return m_height;
+}
+
+int Rect::right() const
+{
+  return m_x + m_width - 1;
+}
+
+int Rect::bottom() const
+{
+  return m_y + m_height - 1;
+}
+
+bool Rect::isEmpty() const
+{
+  return m_width <= 0 || m_height <= 0;
+}
+
+bool Rect::contains(const Point &point) const
+{
+  return point.x() >= m_x && point.x() <= right() && point.y() >= m_y && point.y() <= bottom();
+}
+
+}
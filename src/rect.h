@@ -0,0 +1,80 @@
+/**********************************************************************************
+*  MIT License                                                                    *
+*                                                                                 *
+*  Copyright (c) 2022 Vahan Aghajanyan <vahancho@gmail.com>                       *
+*                                                                                 *
+*  Permission is hereby granted, free of charge, to any person obtaining a copy   *
+*  of this software and associated documentation files (the "Software"), to deal  *
+*  in the Software without restriction, including without limitation the rights   *
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+*  copies of the Software, and to permit persons to whom the Software is          *
+*  furnished to do so, subject to the following conditions:                       *
+*                                                                                 *
+*  The above copyright notice and this permission notice shall be included in all *
+*  copies or substantial portions of the Software.                                *
+*                                                                                 *
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+*  SOFTWARE.                                                                      *
+***********************************************************************************/
+
+#ifndef _RECT_H_
+#define _RECT_H_
+
+#include "export.h"
+#include "point.h"
+
+namespace nkar
+{
+
+//! Implements an axis aligned rectangle of pixels.
+class NKAR_EXPORT Rect
+{
+public:
+  //! Constructs a rectangle with the upper left corner (\p x, \p y) and the given size.
+  Rect(int x = 0, int y = 0, int width = 0, int height = 0);
+
+  //! Compares two rectangles.
+  /*!
+    Rectangles are equal if they have the same position and size.
+  */
+  bool operator==(const Rect &other) const;
+
+  //! Returns the x coordinate of the left column of the rectangle.
+  int x() const;
+
+  //! Returns the y coordinate of the top row of the rectangle.
+  int y() const;
+
+  //! Returns the width of the rectangle.
+  int width() const;
+
+  //! Returns the height of the rectangle.
+  int height() const;
+
+  //! Returns the x coordinate of the right column of the rectangle.
+  int right() const;
+
+  //! Returns the y coordinate of the bottom row of the rectangle.
+  int bottom() const;
+
+  //! Returns true if the rectangle has no pixels.
+  bool isEmpty() const;
+
+  //! Returns true if the given \p point is inside the rectangle.
+  bool contains(const Point &point) const;
+
+private:
+  int m_x;
+  int m_y;
+  int m_width;
+  int m_height;
+};
+
+}
+
+#endif // _RECT_H_
@@ -0,0 +1,297 @@
+/**********************************************************************************
+*  MIT License                                                                    *
+*                                                                                 *
+*  Copyright (c) 2022 Vahan Aghajanyan <vahancho@gmail.com>                       *
+*                                                                                 *
+*  Permission is hereby granted, free of charge, to any person obtaining a copy   *
+*  of this software and associated documentation files (the "Software"), to deal  *
+*  in the Software without restriction, including without limitation the rights   *
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+*  copies of the Software, and to permit persons to whom the Software is          *
+*  furnished to do so, subject to the following conditions:                       *
+*                                                                                 *
+*  The above copyright notice and this permission notice shall be included in all *
+*  copies or substantial portions of the Software.                                *
+*                                                                                 *
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+*  SOFTWARE.                                                                      *
+***********************************************************************************/
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+#include <fstream>
+
+#include "parallel.h"
+#include "tileindex.h"
+
+namespace nkar
+{
+
+static constexpr int s_tileSize = 64;
+
+// The file format signature and version.
+static constexpr char s_signature[4] = { 'N', 'K', 'T', 'I' };
+static constexpr uint32_t s_version = 1;
+
+// The constants of the hash function.
+static constexpr uint64_t s_prime1 = 0x9E3779B185EBCA87ULL;
+static constexpr uint64_t s_prime2 = 0xC2B2AE3D27D4EB4FULL;
+static constexpr uint64_t s_prime3 = 0x165667B19E3779F9ULL;
+
+static inline uint64_t rotateLeft(uint64_t value, int bits)
+{
+  return (value << bits) | (value >> (64 - bits));
+}
+
+//! Mixes the \p word into the hash \p lane.
+static inline uint64_t mix(uint64_t lane, uint64_t word)
+{
+  return rotateLeft(lane + word * s_prime2, 31) * s_prime1;
+}
+
+//! Computes the hash of pixels of the tile with the given origin and dimensions.
+/*!
+  The rows of the tile are read as 64-bit words, that are mixed into four
+  independent lanes, so the lanes are processed in parallel by the CPU. Unused
+  bytes of pixels are masked out.
+*/
+static uint64_t tileHash(const ImageView &view, int x, int y, int width, int height)
+{
+  const int bytesPerPixel = view.bytesPerPixel();
+  const bool padded = view.format() == PixelFormat::RGBX || view.format() == PixelFormat::BGRX;
+  // The unused byte is the last one of each 4-byte pixel.
+  const uint64_t used = padded ? 0x00FFFFFF00FFFFFFULL : ~uint64_t(0);
+  const size_t size = (size_t)width * bytesPerPixel;
+
+  uint64_t lanes[4] = { s_prime1, s_prime2, s_prime3, 0 };
+  for (int row = y; row < y + height; ++row) {
+    const uint8_t *data = view.scanline(row) + (size_t)x * bytesPerPixel;
+
+    size_t offset = 0;
+    for (; offset + 32 <= size; offset += 32) {
+      for (int lane = 0; lane < 4; ++lane) {
+        uint64_t word;
+        memcpy(&word, data + offset + lane * 8, 8);
+        lanes[lane] = mix(lanes[lane], word & used);
+      }
+    }
+    for (int lane = 0; offset < size; offset += 8, ++lane) {
+      uint64_t word = 0;
+      memcpy(&word, data + offset, std::min<size_t>(8, size - offset));
+      lanes[lane] = mix(lanes[lane], word & used);
+    }
+  }
+
+  uint64_t hash = rotateLeft(lanes[0], 1) + rotateLeft(lanes[1], 7) +
+                  rotateLeft(lanes[2], 12) + rotateLeft(lanes[3], 18);
+  hash ^= hash >> 33;
+  hash *= s_prime2;
+  hash ^= hash >> 29;
+  hash *= s_prime3;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+//! Writes the \p value to the \p stream in the little-endian byte order.
+template <typename T>
+static void write(std::ostream &stream, T value)
+{
+  for (size_t i = 0; i < sizeof(T); ++i) {
+    stream.put((char)((uint64_t)value >> (i * 8)));
+  }
+}
+
+//! Reads the \p value written in the little-endian byte order from the \p stream.
+template <typename T>
+static bool read(std::istream &stream, T &value)
+{
+  uint64_t result = 0;
+  for (size_t i = 0; i < sizeof(T); ++i) {
+    const int byte = stream.get();
+    if (byte == std::istream::traits_type::eof()) {
+      return false;
+    }
+    result |= uint64_t(byte) << (i * 8);
+  }
+  value = (T)result;
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+TileIndex::TileIndex() noexcept
+  :
+    m_width(0),
+    m_height(0),
+    m_format(PixelFormat::RGB),
+    m_columns(0),
+    m_rows(0)
+{}
+
+TileIndex::TileIndex(const ImageView &view, int threadCount)
+  :
+    TileIndex()
+{
+  if (view.isNull()) {
+    return;
+  }
+
+  m_width = view.width();
+  m_height = view.height();
+  m_format = view.format();
+  m_columns = (m_width + s_tileSize - 1) / s_tileSize;
+  m_rows = (m_height + s_tileSize - 1) / s_tileSize;
+  m_hashes.resize((size_t)m_columns * m_rows);
+
+  forEachBand(m_rows, effectiveThreadCount(threadCount), [&](int, int begin, int end) {
+    for (int row = begin; row < end; ++row) {
+      const int y = row * s_tileSize;
+      const int height = std::min(s_tileSize, m_height - y);
+      for (int column = 0; column < m_columns; ++column) {
+        const int x = column * s_tileSize;
+        const int width = std::min(s_tileSize, m_width - x);
+        m_hashes[(size_t)row * m_columns + column] = tileHash(view, x, y, width, height);
+      }
+    }
+  });
+}
+
+int TileIndex::tileSize()
+{
+  return s_tileSize;
+}
+
+bool TileIndex::isNull() const
+{
+  return m_hashes.empty();
+}
+
+int TileIndex::width() const
+{
+  return m_width;
+}
+
+int TileIndex::height() const
+{
+  return m_height;
+}
+
+PixelFormat TileIndex::format() const
+{
+  return m_format;
+}
+
+int TileIndex::columns() const
+{
+  return m_columns;
+}
+
+int TileIndex::rows() const
+{
+  return m_rows;
+}
+
+uint64_t TileIndex::hash(int column, int row) const
+{
+  assert(column >= 0 && column < m_columns && row >= 0 && row < m_rows);
+  return m_hashes[(size_t)row * m_columns + column];
+}
+
+bool TileIndex::isCompatible(const TileIndex &other) const
+{
+  return m_width == other.m_width && m_height == other.m_height &&
+         m_format == other.m_format;
+}
+
+BitMask TileIndex::difference(const TileIndex &other) const
+{
+  assert(isCompatible(other));
+
+  BitMask mask(m_columns, m_rows);
+  for (int row = 0; row < m_rows; ++row) {
+    for (int column = 0; column < m_columns; ++column) {
+      if (hash(column, row) != other.hash(column, row)) {
+        mask.set(column, row);
+      }
+    }
+  }
+  return mask;
+}
+
+bool TileIndex::save(const std::string &file) const
+{
+  std::ofstream stream(file, std::ios::binary);
+  if (!stream) {
+    return false;
+  }
+
+  stream.write(s_signature, sizeof(s_signature));
+  write<uint32_t>(stream, s_version);
+  write<uint32_t>(stream, s_tileSize);
+  write<uint32_t>(stream, m_width);
+  write<uint32_t>(stream, m_height);
+  write<uint32_t>(stream, (uint32_t)m_format);
+  for (auto hash : m_hashes) {
+    write<uint64_t>(stream, hash);
+  }
+
+  return (bool)stream;
+}
+
+bool TileIndex::open(const std::string &file)
+{
+  std::ifstream stream(file, std::ios::binary);
+  if (!stream) {
+    return false;
+  }
+
+  char signature[sizeof(s_signature)];
+  uint32_t version, tileSize, width, height, format;
+  if (!stream.read(signature, sizeof(signature)) ||
+      memcmp(signature, s_signature, sizeof(signature)) != 0 ||
+      !read(stream, version) || version != s_version ||
+      !read(stream, tileSize) || tileSize != s_tileSize ||
+      !read(stream, width) || !read(stream, height) || !read(stream, format) ||
+      width > (uint32_t)INT32_MAX || height > (uint32_t)INT32_MAX ||
+      format > (uint32_t)PixelFormat::BGRX) {
+    return false;
+  }
+
+  // The rest of the file must hold exactly one hash per tile.
+  const int64_t columns = ((int64_t)width + s_tileSize - 1) / s_tileSize;
+  const int64_t rows = ((int64_t)height + s_tileSize - 1) / s_tileSize;
+  const std::streamoff position = stream.tellg();
+  if (position < 0 || !stream.seekg(0, std::ios::end)) {
+    return false;
+  }
+  const std::streamoff size = stream.tellg();
+  if (size < position ||
+      (uint64_t)(size - position) != (uint64_t)(columns * rows) * sizeof(uint64_t) ||
+      !stream.seekg(position)) {
+    return false;
+  }
+
+  TileIndex index;
+  index.m_width = (int)width;
+  index.m_height = (int)height;
+  index.m_format = (PixelFormat)format;
+  index.m_columns = (int)columns;
+  index.m_rows = (int)rows;
+  index.m_hashes.resize((size_t)columns * (size_t)rows);
+  for (auto &hash : index.m_hashes) {
+    if (!read(stream, hash)) {
+      return false;
+    }
+  }
+
+  *this = index;
+  return true;
+}
+
+}
@@ -0,0 +1,118 @@
+/**********************************************************************************
+*  MIT License                                                                    *
+*                                                                                 *
+*  Copyright (c) 2022 Vahan Aghajanyan <vahancho@gmail.com>                       *
+*                                                                                 *
+*  Permission is hereby granted, free of charge, to any person obtaining a copy   *
+*  of this software and associated documentation files (the "Software"), to deal  *
+*  in the Software without restriction, including without limitation the rights   *
+*  to use, copy, modify, merge, publish, distribute, sublicense, and/or sell      *
+*  copies of the Software, and to permit persons to whom the Software is          *
+*  furnished to do so, subject to the following conditions:                       *
+*                                                                                 *
+*  The above copyright notice and this permission notice shall be included in all *
+*  copies or substantial portions of the Software.                                *
+*                                                                                 *
+*  THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR     *
+*  IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,       *
+*  FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE    *
+*  AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER         *
+*  LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,  *
+*  OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE  *
+*  SOFTWARE.                                                                      *
+***********************************************************************************/
+
+#ifndef _TILEINDEX_H_
+#define _TILEINDEX_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "bitmask.h"
+#include "export.h"
+#include "imageview.h"
+
+namespace nkar
+{
+
+//! Implements an index of hashes of square image tiles.
+/*!
+  The image is split into tiles of tileSize() x tileSize() pixels (the tiles of the
+  last column and row may be smaller), and a fast non-cryptographic hash of pixels
+  of each tile is stored. Comparing indexes of two images tells which tiles may
+  differ, so the pixel level comparison is only necessary for them.
+
+  The index can be saved to a file and opened later, so the index of a baseline
+  image is computed only once.
+*/
+class NKAR_EXPORT TileIndex
+{
+public:
+  //! Constructs an empty index.
+  TileIndex() noexcept;
+
+  //! Constructs the index of the image pixel data the \p view refers to.
+  /*!
+    The tile hashes are computed in parallel if \p threadCount is greater than one.
+    The value 0 means that all hardware threads are used.
+  */
+  explicit TileIndex(const ImageView &view, int threadCount = 1);
+
+  //! Returns the width and the height of the tiles in pixels.
+  static int tileSize();
+
+  //! Returns true if the index contains no hashes.
+  bool isNull() const;
+
+  //! Returns the width of the indexed image.
+  int width() const;
+
+  //! Returns the height of the indexed image.
+  int height() const;
+
+  //! Returns the pixel format of the indexed image.
+  PixelFormat format() const;
+
+  //! Returns the number of tile columns.
+  int columns() const;
+
+  //! Returns the number of tile rows.
+  int rows() const;
+
+  //! Returns the hash of the given tile.
+  uint64_t hash(int column, int row) const;
+
+  //! Returns true if both indexes are of images of the same dimensions and pixel format.
+  bool isCompatible(const TileIndex &other) const;
+
+  //! Returns the mask of tiles, that have different hashes in this and \p other indexes.
+  /*!
+    The mask has one bit per tile. The indexes must be compatible.
+  */
+  BitMask difference(const TileIndex &other) const;
+
+  //! Saves the index to the given file.
+  /*!
+    \return true on success and false otherwise.
+  */
+  bool save(const std::string &file) const;
+
+  //! Opens the index saved to the given file.
+  /*!
+    \return true on success and false otherwise. The index isn't changed on failure.
+  */
+  bool open(const std::string &file);
+
+private:
+  std::vector<uint64_t> m_hashes;
+  int m_width;
+  int m_height;
+  PixelFormat m_format;
+  int m_columns;
+  int m_rows;
+};
+
+}
+
+#endif // _TILEINDEX_H_
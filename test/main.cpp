@@ -22,12 +22,21 @@
 *  SOFTWARE.                                                                      *
 ***********************************************************************************/
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <numeric>
+#include <stdexcept>
 #include <string>
 #include <cstdio>
 #include <chrono>
+#include <climits>
+#include <thread>
+#include <type_traits>
+#include <vector>
 
 #include "comparator.h"
+#include "parallel.h"
 #include "point.h"
 
 enum Status
@@ -46,10 +55,10 @@ enum Status
     }
 
 bool test(const std::string &img1, const std::string img2, const std::string &tmpImg,
-          const std::string &baseline, const nkar::Color &highlightColor = {255, 0, 0})
+          const std::string &baseline, const nkar::Options &options)
 {
   auto start = std::chrono::high_resolution_clock::now();
-  auto result = nkar::Comparator::compare(img1, img2, highlightColor);
+  auto result = nkar::Comparator::compare(img1, img2, options);
   auto end = std::chrono::high_resolution_clock::now();
 
   std::cout << "comparison duration: "
@@ -73,6 +82,37 @@ bool test(const std::string &img1, const std::string img2, const std::string &tm
   return true;
 }
 
+bool test(const std::string &img1, const std::string img2, const std::string &tmpImg,
+          const std::string &baseline, const nkar::Color &highlightColor = {255, 0, 0})
+{
+  nkar::Options options;
+  options.setHighlightColor(highlightColor);
+  return test(img1, img2, tmpImg, baseline, options);
+}
+
+bool sameColor(const nkar::Color &color1, const nkar::Color &color2)
+{
+  return color1.red() == color2.red() && color1.green() == color2.green() &&
+         color1.blue() == color2.blue();
+}
+
+// Repacks the image pixels into the BGRX format with the given row stride.
+std::vector<uint8_t> toBgrx(const nkar::Image &image, int stride, uint8_t unused)
+{
+  std::vector<uint8_t> data(stride * image.height());
+  for (int r = 0; r < image.height(); ++r) {
+    for (int c = 0; c < image.width(); ++c) {
+      const nkar::Color color = image.pixel(r, c);
+      uint8_t *pixel = &data[r * stride + c * 4];
+      pixel[0] = color.blue();
+      pixel[1] = color.green();
+      pixel[2] = color.red();
+      pixel[3] = unused;
+    }
+  }
+  return data;
+}
+
 int main(int argc, char **argv)
 {
   if (argc != 2) {
@@ -91,6 +131,12 @@ int main(int argc, char **argv)
   TEST(color.green() == 254);
   TEST(color.blue() == 255);
 
+  // The comparison kernels
+  const std::string kernel = nkar::Comparator::kernelName();
+  std::cout << "Comparison kernels: " << kernel << '\n';
+  TEST(kernel == "scalar" || kernel == "sse4.1" || kernel == "avx2" ||
+       kernel == "avx512" || kernel == "neon");
+
   const std::string imagePath(argv[1]);
   const std::string tmpImg(imagePath + "/tmp.png");
   {
@@ -112,6 +158,15 @@ int main(int argc, char **argv)
     TEST(result.error() == nkar::Result::Error::DifferentDimensions);
   }
 
+  {
+    // Identical images
+    auto result = nkar::Comparator::compare(imagePath + "/map1.png", imagePath + "/map1.png");
+    TEST(result.status() == nkar::Result::Status::Identical);
+    TEST(result.error() == nkar::Result::Error::NoError);
+    TEST(result.contourCount() == 0);
+    TEST(result.resultImage().isNull());
+  }
+
   // Images
   for (int i = 1; i < 19; ++i) {
     const std::string baseline(imagePath + "/" + std::to_string(i) + "_result.png");
@@ -127,6 +182,759 @@ int main(int argc, char **argv)
   TEST(test(imagePath + "/map1.png", imagePath + "/map2.png", tmpImg,
              imagePath + "/map_result.png"));
 
+  // Multi-threaded comparison produces the same contours.
+  {
+    nkar::Options options;
+    TEST(options.threadCount() == 1);
+    options.setThreadCount(4);
+    for (int i = 1; i < 19; ++i) {
+      const std::string baseline(imagePath + "/" + std::to_string(i) + "_result.png");
+      TEST(test(imagePath + "/empty.png", imagePath + "/" + std::to_string(i) + ".png",
+                tmpImg, baseline, options));
+    }
+    TEST(test(imagePath + "/map1.png", imagePath + "/map2.png", tmpImg,
+              imagePath + "/map_result.png", options));
+
+    options.setThreadCount(0);
+    options.setHighlightColor({51, 255, 51});
+    TEST(test(imagePath + "/lenna.png", imagePath + "/lenna_changed.png", tmpImg,
+              imagePath + "/lenna_result.png", options));
+
+    // Huge thread counts are limited.
+    options.setThreadCount(100000);
+    TEST(test(imagePath + "/lenna.png", imagePath + "/lenna_changed.png", tmpImg,
+              imagePath + "/lenna_result.png", options));
+  }
+
+  // Parallel bands
+  {
+    std::atomic<int> bands{ 0 };
+    nkar::forEachBand(1000, 1000, [&](int, int, int) {
+      ++bands;
+    });
+    TEST(bands == 64);
+
+    // The exceptions of bands are rethrown on the calling thread after all bands finish.
+    for (int failed : { 0, 2 }) {
+      bands = 0;
+      bool caught = false;
+      try {
+        nkar::forEachBand(100, 4, [&](int band, int, int) {
+          ++bands;
+          if (band == failed) {
+            throw std::runtime_error("band");
+          }
+        });
+      } catch (const std::runtime_error &) {
+        caught = true;
+      }
+      TEST(caught && bands == 4);
+    }
+  }
+
+  // Image views
+  {
+    nkar::Image lenna(imagePath + "/lenna.png");
+    nkar::Image changed(imagePath + "/lenna_changed.png");
+    nkar::Image baseline(imagePath + "/lenna_result.png");
+
+    const int stride = lenna.width() * 4 + 12;
+    auto lennaData = toBgrx(lenna, stride, 0);
+    auto changedData = toBgrx(changed, stride, 255);
+    nkar::ImageView lennaView(lennaData.data(), lenna.width(), lenna.height(), stride,
+                              nkar::PixelFormat::BGRX);
+    nkar::ImageView changedView(changedData.data(), changed.width(), changed.height(), stride,
+                                nkar::PixelFormat::BGRX);
+    TEST(lennaView.bytesPerPixel() == 4);
+    TEST(lennaView.pixel(5, 7).red() == lenna.pixel(5, 7).red());
+    TEST(lennaView.pixel(5, 7).green() == lenna.pixel(5, 7).green());
+    TEST(lennaView.pixel(5, 7).blue() == lenna.pixel(5, 7).blue());
+    TEST(nkar::ImageView().isNull());
+    TEST(nkar::Image(nkar::ImageView()).isNull());
+
+    // The same image in different pixel formats.
+    TEST(nkar::Comparator::compare(lennaView, lenna.view()).status() ==
+         nkar::Result::Status::Identical);
+
+    // Unused bytes are ignored.
+    auto padded = toBgrx(lenna, stride, 255);
+    nkar::ImageView paddedView(padded.data(), lenna.width(), lenna.height(), stride,
+                               nkar::PixelFormat::BGRX);
+    TEST(nkar::Comparator::compare(lennaView, paddedView).status() ==
+         nkar::Result::Status::Identical);
+
+    nkar::Options options;
+    options.setHighlightColor({51, 255, 51});
+
+    // Different pixel formats.
+    auto result = nkar::Comparator::compare(lennaView, changed.view(), options);
+    TEST(result.status() == nkar::Result::Status::Different);
+    TEST(nkar::Comparator::compare(result.resultImage(), baseline).status() ==
+         nkar::Result::Status::Identical);
+
+    // The same pixel format.
+    result = nkar::Comparator::compare(lennaView, changedView, options);
+    TEST(result.status() == nkar::Result::Status::Different);
+    TEST(nkar::Comparator::compare(result.resultImage(), baseline).status() ==
+         nkar::Result::Status::Identical);
+  }
+
+  // Tolerant comparison
+  {
+    nkar::Image lenna(imagePath + "/lenna.png");
+    const int width = lenna.width();
+    const int height = lenna.height();
+
+    // Shift channels by up to 2 levels.
+    std::vector<uint8_t> noisy(lenna.scanline(0), lenna.scanline(0) + width * height * 3);
+    for (size_t i = 0; i < noisy.size(); ++i) {
+      noisy[i] = noisy[i] < 128 ? noisy[i] + i % 3 : noisy[i] - i % 3;
+    }
+    nkar::ImageView noisyView(noisy.data(), width, height, width * 3);
+
+    nkar::Options options;
+    TEST(nkar::Comparator::compare(lenna.view(), noisyView, options).status() ==
+         nkar::Result::Status::Different);
+    options.setMaxChannelDelta(2);
+    TEST(nkar::Comparator::compare(lenna.view(), noisyView, options).status() ==
+         nkar::Result::Status::Identical);
+    options.setMaxChannelDelta(1);
+    TEST(nkar::Comparator::compare(lenna.view(), noisyView, options).status() ==
+         nkar::Result::Status::Different);
+
+    // The same in the 4-byte pixel format.
+    const int stride = width * 4;
+    auto lennaData = toBgrx(lenna, stride, 0);
+    auto noisyData = toBgrx(nkar::Image(noisyView), stride, 1);
+    nkar::ImageView lennaBgrx(lennaData.data(), width, height, stride, nkar::PixelFormat::BGRX);
+    nkar::ImageView noisyBgrx(noisyData.data(), width, height, stride, nkar::PixelFormat::BGRX);
+    TEST(nkar::Comparator::compare(lennaBgrx, noisyBgrx, options).status() ==
+         nkar::Result::Status::Different);
+    options.setMaxChannelDelta(2);
+    TEST(nkar::Comparator::compare(lennaBgrx, noisyBgrx, options).status() ==
+         nkar::Result::Status::Identical);
+
+    // The sum of channel differences of a noisy pixel is at most 3.
+    options.setMaxSumDelta(2);
+    TEST(nkar::Comparator::compare(lenna.view(), noisyView, options).status() ==
+         nkar::Result::Status::Different);
+    TEST(nkar::Comparator::compare(lennaBgrx, noisyBgrx, options).status() ==
+         nkar::Result::Status::Different);
+    TEST(!nkar::Comparator::isIdentical(lenna.view(), noisyView, options));
+    options.setMaxSumDelta(3);
+    TEST(nkar::Comparator::compare(lenna.view(), noisyView, options).status() ==
+         nkar::Result::Status::Identical);
+    TEST(nkar::Comparator::compare(lennaBgrx, noisyBgrx, options).status() ==
+         nkar::Result::Status::Identical);
+    TEST(nkar::Comparator::isIdentical(lenna.view(), noisyView, options));
+    TEST(nkar::Comparator::isIdentical(lennaBgrx, noisyBgrx, options));
+    TEST(!nkar::Comparator::isIdentical(lenna.view(), noisyView));
+
+    // Real differences are still found.
+    nkar::Image lennaChanged(imagePath + "/lenna_changed.png");
+    auto result = nkar::Comparator::compare(lenna, lennaChanged, options);
+    TEST(result.status() == nkar::Result::Status::Different);
+    TEST(result.contourCount() > 0);
+  }
+
+  // Identity check
+  {
+    TEST(nkar::Comparator::isIdentical(imagePath + "/map1.png", imagePath + "/map1.png"));
+    TEST(!nkar::Comparator::isIdentical(imagePath + "/map1.png", imagePath + "/map2.png"));
+    TEST(!nkar::Comparator::isIdentical(imagePath + "/map1.png", imagePath + "/lenna.png"));
+    TEST(!nkar::Comparator::isIdentical(imagePath + "/map1.png", imagePath + "/missing.png"));
+
+    nkar::Image lenna(imagePath + "/lenna.png");
+    nkar::Image changed(imagePath + "/lenna_changed.png");
+    TEST(nkar::Comparator::isIdentical(lenna, lenna));
+    TEST(!nkar::Comparator::isIdentical(lenna, changed));
+
+    nkar::Options options;
+    options.setThreadCount(4);
+    TEST(!nkar::Comparator::isIdentical(lenna, changed, options));
+
+    // Views of different formats.
+    const int stride = lenna.width() * 4;
+    auto lennaData = toBgrx(lenna, stride, 0);
+    auto changedData = toBgrx(changed, stride, 0);
+    nkar::ImageView lennaBgrx(lennaData.data(), lenna.width(), lenna.height(), stride,
+                              nkar::PixelFormat::BGRX);
+    nkar::ImageView changedBgrx(changedData.data(), lenna.width(), lenna.height(), stride,
+                                nkar::PixelFormat::BGRX);
+    TEST(nkar::Comparator::isIdentical(lennaBgrx, lenna.view(), options));
+    TEST(!nkar::Comparator::isIdentical(changedBgrx, lenna.view(), options));
+    TEST(!nkar::Comparator::isIdentical(lennaBgrx, changedBgrx, options));
+  }
+
+  // Difference mask
+  {
+    nkar::Image empty(imagePath + "/empty.png");
+    std::vector<uint8_t> dots(empty.scanline(0),
+                              empty.scanline(0) + empty.width() * empty.height() * 3);
+    const int points[][2] = { { 0, 0 }, { 70, 3 }, { 63, 10 }, { 64, 10 },
+                              { empty.width() - 1, empty.height() - 1 } };
+    for (const auto &point : points) {
+      dots[(point[1] * empty.width() + point[0]) * 3 + 1] ^= 0x80;
+    }
+    auto result = nkar::Comparator::compare(
+      empty.view(), nkar::ImageView(dots.data(), empty.width(), empty.height(), empty.width() * 3));
+    const nkar::BitMask &mask = result.differenceMask();
+    TEST(mask.width() == empty.width() && mask.height() == empty.height());
+    TEST(mask.count() == 5);
+    for (const auto &point : points) {
+      TEST(mask.test(point[0], point[1]));
+    }
+
+    std::vector<std::pair<int, int>> bits;
+    mask.forEachSetBit([&bits](int x, int y) { bits.emplace_back(x, y); });
+    TEST(bits.size() == 5);
+    TEST(bits[0] == std::make_pair(0, 0) && bits[1] == std::make_pair(70, 3));
+    TEST(bits[2] == std::make_pair(63, 10) && bits[3] == std::make_pair(64, 10));
+
+    std::vector<int> wordPositions;
+    mask.forEachWord([&wordPositions](int x, int, uint64_t) { wordPositions.push_back(x); });
+    TEST(wordPositions.size() == 5);
+    TEST(wordPositions[1] == 64 && wordPositions[2] == 0 && wordPositions[3] == 64);
+
+    // The mask has pixel precision regardless of the block size.
+    nkar::Options options;
+    options.setBlockSize(8, 8);
+    TEST(nkar::Comparator::compare(empty.view(), nkar::ImageView(dots.data(), empty.width(),
+         empty.height(), empty.width() * 3), options).differenceMask().count() == 5);
+
+    TEST(nkar::Comparator::compare(empty, empty).differenceMask().isNull());
+  }
+
+  // Contours are connected groups of differences.
+  {
+    nkar::Image empty(imagePath + "/empty.png");
+    auto compareWith = [&empty](const std::vector<std::pair<int, int>> &points) {
+      std::vector<uint8_t> data(empty.scanline(0),
+                                empty.scanline(0) + empty.width() * empty.height() * 3);
+      for (const auto &point : points) {
+        data[(point.second * empty.width() + point.first) * 3] ^= 0xFF;
+      }
+      nkar::ImageView view(data.data(), empty.width(), empty.height(), empty.width() * 3);
+      return nkar::Comparator::compare(empty.view(), view);
+    };
+    auto countContours = [&compareWith](const std::vector<std::pair<int, int>> &points) {
+      return compareWith(points).contourCount();
+    };
+    TEST(countContours({ { 10, 10 } }) == 1);
+    TEST(countContours({ { 10, 10 }, { 20, 10 } }) == 2);
+    TEST(countContours({ { 10, 10 }, { 10, 20 }, { 20, 20 } }) == 3);
+    // Outlines touching by corners.
+    TEST(countContours({ { 10, 10 }, { 12, 12 } }) == 1);
+    TEST(countContours({ { 10, 10 }, { 13, 13 } }) == 2);
+    // Outlines of a hole and of its square are separate.
+    std::vector<std::pair<int, int>> square;
+    for (int i = 0; i < 10; ++i) {
+      square.emplace_back(10 + i, 10);
+      square.emplace_back(10 + i, 19);
+      square.emplace_back(10, 10 + i);
+      square.emplace_back(19, 10 + i);
+    }
+    TEST(countContours(square) == 2);
+
+    // Outline polygons.
+    auto result = compareWith({ { 10, 10 } });
+    const nkar::Contours &contours = result.contours();
+    TEST(contours.size() == 1 && contours.contour(0) == 0);
+    TEST(contours.vertexCount(0) == 4);
+    const nkar::Point *polygon = contours.polygon(0);
+    TEST(polygon[0] == nkar::Point(11, 9) && polygon[1] == nkar::Point(11, 11));
+    TEST(polygon[2] == nkar::Point(9, 11) && polygon[3] == nkar::Point(9, 9));
+    TEST(contours.offsets().size() == 2 && contours.offsets()[1] == 4);
+    TEST(contours.vertices().size() == 4);
+
+    // Outlines touching by corners make one polygon.
+    result = compareWith({ { 10, 10 }, { 12, 12 } });
+    TEST(result.contours().size() == 1 && result.contours().vertexCount(0) == 8);
+
+    // A hole has its own polygon going in the opposite direction.
+    result = compareWith(square);
+    TEST(result.contours().size() == 2);
+    for (size_t i = 0; i < result.contours().size(); ++i) {
+      long long area = 0;
+      const size_t count = result.contours().vertexCount(i);
+      const nkar::Point *vertices = result.contours().polygon(i);
+      for (size_t v = 0; v < count; ++v) {
+        const nkar::Point &next = vertices[(v + 1) % count];
+        area += (long long)vertices[v].x() * next.y() - (long long)next.x() * vertices[v].y();
+      }
+      TEST(i == 0 ? area > 0 : area < 0);
+    }
+
+    // The polygons form a tree of nested regions.
+    auto island = square;
+    island.emplace_back(14, 14);
+    result = compareWith(island);
+    const nkar::Contours &tree = result.contours();
+    TEST(tree.size() == 3);
+    TEST(!tree.isHole(0) && tree.parent(0) == nkar::Contours::npos);
+    TEST(tree.isHole(1) && tree.parent(1) == 0);
+    TEST(!tree.isHole(2) && tree.parent(2) == 1);
+    TEST(tree.area(1) == 7 * 7 && tree.area(2) == 2 * 2);
+    // The area of the ring region.
+    TEST(tree.area(0) - tree.area(1) == 68);
+
+    // Simplification replaces the staircase outline of a diagonal line with slanted segments.
+    std::vector<std::pair<int, int>> diagonal;
+    for (int i = 0; i < 20; ++i) {
+      diagonal.emplace_back(10 + i, 10 + i);
+    }
+    result = compareWith(diagonal);
+    nkar::Contours simplified = result.contours();
+    TEST(simplified.size() == 1 && simplified.vertexCount(0) == 80);
+    simplified.simplify(0);
+    TEST(simplified.vertices() == result.contours().vertices());
+    simplified.simplify(1);
+    TEST(simplified.vertexCount(0) == 6);
+    TEST(simplified.polygon(0)[1] == nkar::Point(30, 28));
+    TEST(simplified.polygon(0)[4] == nkar::Point(9, 11));
+    TEST(simplified.offsets().back() == simplified.vertices().size());
+    for (size_t i = 0; i < simplified.vertexCount(0); ++i) {
+      const nkar::Point *original = result.contours().polygon(0);
+      TEST(std::find(original, original + 80, simplified.polygon(0)[i]) != original + 80);
+    }
+    // A polygon keeps at least three vertices.
+    simplified = compareWith({ { 10, 10 } }).contours();
+    simplified.simplify(1000);
+    TEST(simplified.vertexCount(0) == 3);
+
+    nkar::Options options;
+    TEST(options.simplificationTolerance() == 0);
+    options.setSimplificationTolerance(1.5);
+    TEST(nkar::Comparator::compare(empty, nkar::Image(imagePath + "/13.png"), options)
+         .contours().vertices().size() <
+         nkar::Comparator::compare(empty, nkar::Image(imagePath + "/13.png"))
+         .contours().vertices().size());
+
+    TEST(nkar::Comparator::compare(empty, empty).contours().isEmpty());
+  }
+
+  // Difference limits
+  {
+    nkar::Image map1(imagePath + "/map1.png");
+    nkar::Image map2(imagePath + "/map2.png");
+
+    nkar::Options options;
+    TEST(options.maxDifferentPixels() == 0 && options.maxContours() == 0);
+    auto result = nkar::Comparator::compare(map1, map2, options);
+    TEST(!result.isTruncated());
+    const size_t contourCount = result.contourCount();
+    TEST(contourCount > 10);
+
+    options.setMaxDifferentPixels(100);
+    result = nkar::Comparator::compare(map1, map2, options);
+    TEST(result.status() == nkar::Result::Status::Different);
+    TEST(result.isTruncated());
+    TEST(result.contourCount() == 0);
+    TEST(result.resultImage().isNull());
+
+    options.setThreadCount(4);
+    TEST(nkar::Comparator::compare(map1, map2, options).isTruncated());
+
+    options.setMaxDifferentPixels(map1.width() * map1.height());
+    result = nkar::Comparator::compare(map1, map2, options);
+    TEST(!result.isTruncated());
+    TEST(result.contourCount() == contourCount);
+
+    options.setMaxContours(10);
+    result = nkar::Comparator::compare(map1, map2, options);
+    TEST(result.status() == nkar::Result::Status::Different);
+    TEST(result.isTruncated());
+    TEST(result.contourCount() == 10);
+    TEST(!result.resultImage().isNull());
+
+    options.setMaxContours(contourCount);
+    result = nkar::Comparator::compare(map1, map2, options);
+    TEST(!result.isTruncated());
+    TEST(result.contourCount() == contourCount);
+
+    // The same contours are outlined regardless of the number of threads.
+    options.setMaxContours(10);
+    options.setThreadCount(1);
+    const auto expected = nkar::Comparator::compare(map1, map2, options);
+    size_t largest = 0;
+    for (size_t i = 0; i < expected.contours().size(); ++i) {
+      largest = std::max(largest, expected.contours().contour(i));
+    }
+    TEST(expected.contours().size() >= 10 && largest == 9);
+    for (int threads : { 2, 3, 7, 16 }) {
+      options.setThreadCount(threads);
+      result = nkar::Comparator::compare(map1, map2, options);
+      TEST(result.contourCount() == 10);
+      TEST(result.contours().vertices() == expected.contours().vertices());
+      TEST(result.contours().offsets() == expected.contours().offsets());
+      TEST(nkar::Comparator::isIdentical(result.resultImage(), expected.resultImage()));
+    }
+  }
+
+  // Tile index
+  {
+    nkar::Image map1(imagePath + "/map1.png");
+    nkar::Image map2(imagePath + "/map2.png");
+    TEST(map1.tileIndex().isNull());
+
+    const int tileSize = nkar::TileIndex::tileSize();
+    nkar::TileIndex index(map1.view());
+    TEST(!index.isNull());
+    TEST(index.columns() == (map1.width() + tileSize - 1) / tileSize);
+    TEST(index.rows() == (map1.height() + tileSize - 1) / tileSize);
+    TEST(index.isCompatible(nkar::TileIndex(map2.view(), 4)));
+    TEST(index.difference(nkar::TileIndex(map1.view(), 4)).count() == 0);
+    const size_t differentTiles = index.difference(nkar::TileIndex(map2.view())).count();
+    TEST(differentTiles > 0 && differentTiles < (size_t)(index.columns() * index.rows()));
+
+    // Results with and without the index are the same.
+    auto expected = nkar::Comparator::compare(map1, map2);
+    map1.buildTileIndex();
+    map2.buildTileIndex(4);
+    TEST(!map1.tileIndex().isNull());
+    auto result = nkar::Comparator::compare(map1, map2);
+    TEST(result.contourCount() == expected.contourCount());
+    TEST(result.differenceMask().count() == expected.differenceMask().count());
+    TEST(nkar::Comparator::isIdentical(result.resultImage(), expected.resultImage()));
+    TEST(result.resultImage().tileIndex().isNull());
+    TEST(!nkar::Comparator::isIdentical(map1, map2));
+    TEST(nkar::Comparator::isIdentical(map1, nkar::Image(map1)));
+    TEST(nkar::Comparator::compare(map1, nkar::Image(map1)).status() ==
+         nkar::Result::Status::Identical);
+
+    // Saved indexes are reusable.
+    const std::string indexFile(tmpImg + ".index");
+    TEST(map1.tileIndex().save(indexFile));
+    nkar::TileIndex saved;
+    TEST(saved.open(indexFile));
+    std::remove(indexFile.c_str());
+    TEST(saved.isCompatible(map1.tileIndex()));
+    TEST(saved.difference(map1.tileIndex()).count() == 0);
+    nkar::Image baseline(imagePath + "/map1.png");
+    TEST(baseline.setTileIndex(saved));
+    TEST(nkar::Comparator::compare(baseline, map2).contourCount() == expected.contourCount());
+    TEST(!nkar::Image(imagePath + "/lenna.png").setTileIndex(saved));
+    TEST(!saved.open(imagePath + "/map1.png"));
+    TEST(!saved.isNull());
+
+    // Indexes with corrupt headers or missing hashes are rejected.
+    auto writeIndex = [&](std::vector<uint32_t> fields) {
+      std::string bytes("NKTI");
+      for (uint32_t field : fields) {
+        for (int i = 0; i < 4; ++i) {
+          bytes += (char)(field >> (i * 8));
+        }
+      }
+      FILE *file = fopen(indexFile.c_str(), "wb");
+      fwrite(bytes.data(), 1, bytes.size(), file);
+      fclose(file);
+    };
+    writeIndex({ 1, 64, 0x7fffffff, 0x7fffffff, 0 });
+    TEST(!saved.open(indexFile));
+    writeIndex({ 1, 64, 100, 64, 0, 0, 0 });
+    TEST(!saved.open(indexFile));
+    writeIndex({ 1, 64, 100, 64, 0, 0, 0, 0, 0 });
+    TEST(saved.open(indexFile) && saved.width() == 100);
+    writeIndex({ 1, 64, 100, 64, 0, 0, 0, 0, 0, 0 });
+    TEST(!saved.open(indexFile) && saved.width() == 100);
+    std::remove(indexFile.c_str());
+
+    // Unused bytes of pixels don't change hashes.
+    const int stride = map1.width() * 4;
+    auto data1 = toBgrx(map1, stride, 0);
+    auto data2 = toBgrx(map1, stride, 0xFF);
+    nkar::TileIndex bgrx1(nkar::ImageView(data1.data(), map1.width(), map1.height(), stride,
+                                          nkar::PixelFormat::BGRX));
+    nkar::TileIndex bgrx2(nkar::ImageView(data2.data(), map1.width(), map1.height(), stride,
+                                          nkar::PixelFormat::BGRX));
+    TEST(bgrx1.difference(bgrx2).count() == 0);
+    TEST(!bgrx1.isCompatible(index));
+  }
+
+  // Comparison blocks
+  {
+    nkar::Options options;
+    TEST(options.blockWidth() == 1 && options.blockHeight() == 1);
+    options.setBlockSize(0, -1);
+    TEST(options.blockWidth() == 1 && options.blockHeight() == 1);
+
+    nkar::Image map1(imagePath + "/map1.png");
+    nkar::Image map2(imagePath + "/map2.png");
+    const size_t preciseCount = nkar::Comparator::compare(map1, map2, options).contourCount();
+
+    options.setBlockSize(8, 8);
+    TEST(options.blockWidth() == 8 && options.blockHeight() == 8);
+    auto coarse = nkar::Comparator::compare(map1, map2, options);
+    TEST(coarse.status() == nkar::Result::Status::Different);
+    TEST(coarse.contourCount() > 0 && coarse.contourCount() < preciseCount);
+
+    // Block contours don't depend on the number of threads.
+    options.setThreadCount(4);
+    auto parallel = nkar::Comparator::compare(map1, map2, options);
+    TEST(parallel.contourCount() == coarse.contourCount());
+    TEST(nkar::Comparator::compare(parallel.resultImage(), coarse.resultImage()).status() ==
+         nkar::Result::Status::Identical);
+
+    // A single different pixel is outlined by its block.
+    nkar::Image empty(imagePath + "/empty.png");
+    std::vector<uint8_t> dot(empty.scanline(0),
+                             empty.scanline(0) + empty.width() * empty.height() * 3);
+    dot[(10 * empty.width() + 13) * 3] ^= 0xFF;
+    options.setBlockSize(4, 2);
+    auto result = nkar::Comparator::compare(
+      empty.view(), nkar::ImageView(dot.data(), empty.width(), empty.height(), empty.width() * 3),
+      options);
+    TEST(result.contourCount() == 1);
+    TEST(sameColor(result.resultImage().pixel(8, 12), options.highlightColor()));
+    TEST(sameColor(result.resultImage().pixel(12, 16), options.highlightColor()));
+    TEST(sameColor(result.resultImage().pixel(10, 14), empty.pixel(10, 14)));
+
+    // The same for other block sizes, including the specialized ones.
+    for (int size : { 1, 2, 3, 4, 8, 16, 20 }) {
+      options.setBlockSize(size, size);
+      result = nkar::Comparator::compare(
+        empty.view(), nkar::ImageView(dot.data(), empty.width(), empty.height(), empty.width() * 3),
+        options);
+      const int left = 13 % size ? 13 / size * size : 13 - size;
+      const int top = 10 % size ? 10 / size * size : 10 - size;
+      const int right = std::min(13 / size * size + size, empty.width() - 1);
+      const int bottom = std::min(10 / size * size + size, empty.height() - 1);
+      TEST(result.contourCount() == 1);
+      TEST(sameColor(result.resultImage().pixel(top, left), options.highlightColor()));
+      TEST(sameColor(result.resultImage().pixel(bottom, right), options.highlightColor()));
+    }
+  }
+
+  // Merging nearby differences
+  {
+    nkar::Options options;
+    TEST(options.mergeRadius() == 0);
+    options.setMergeRadius(-1);
+    TEST(options.mergeRadius() == 0);
+
+    nkar::Image empty(imagePath + "/empty.png");
+    std::vector<uint8_t> dots(empty.scanline(0),
+                              empty.scanline(0) + empty.width() * empty.height() * 3);
+    dots[(10 * empty.width() + 10) * 3] ^= 0xFF;
+    dots[(10 * empty.width() + 14) * 3] ^= 0xFF;
+    dots[(14 * empty.width() + 10) * 3] ^= 0xFF;
+    const nkar::ImageView view(dots.data(), empty.width(), empty.height(), empty.width() * 3);
+    TEST(nkar::Comparator::compare(empty.view(), view, options).contourCount() == 3);
+
+    // The blocks of the dots are separated by two clean blocks.
+    options.setMergeRadius(1);
+    auto result = nkar::Comparator::compare(empty.view(), view, options);
+    TEST(result.contourCount() == 1);
+    TEST(result.contours().size() == 1 && result.contours().vertexCount(0) == 6);
+    TEST(sameColor(result.resultImage().pixel(8, 8), options.highlightColor()));
+    TEST(sameColor(result.resultImage().pixel(8, 16), options.highlightColor()));
+    TEST(sameColor(result.resultImage().pixel(16, 8), options.highlightColor()));
+    TEST(sameColor(result.resultImage().pixel(16, 16), empty.pixel(16, 16)));
+    // The difference mask isn't affected.
+    TEST(result.differenceMask().count() == 3);
+
+    options.setBoundingBoxesOnly(true);
+    result = nkar::Comparator::compare(empty.view(), view, options);
+    TEST(result.boundingBoxes().size() == 1);
+    TEST(result.boundingBoxes()[0] == nkar::Rect(8, 8, 9, 9));
+
+    // Huge radii merge everything without allocating by the radius.
+    options.setMergeRadius(INT_MAX);
+    result = nkar::Comparator::compare(empty.view(), view, options);
+    TEST(result.boundingBoxes().size() == 1);
+    TEST(result.boundingBoxes()[0] == nkar::Rect(0, 0, empty.width(), empty.height()));
+    options.setBoundingBoxesOnly(false);
+    TEST(nkar::Comparator::compare(empty.view(), view, options).contourCount() == 1);
+    options.setMergeRadius(1);
+
+    // Contours merge across band borders and regardless of the block size.
+    nkar::Image map1(imagePath + "/map1.png");
+    nkar::Image map2(imagePath + "/map2.png");
+    options.setBlockSize(4, 4);
+    const auto merged = nkar::Comparator::compare(map1, map2, options);
+    options.setMergeRadius(0);
+    TEST(merged.contourCount() < nkar::Comparator::compare(map1, map2, options).contourCount());
+    options.setMergeRadius(1);
+    options.setThreadCount(5);
+    TEST(nkar::Comparator::compare(map1, map2, options).contours().vertices() ==
+         merged.contours().vertices());
+  }
+
+  // Bounding boxes
+  {
+    nkar::Options options;
+    TEST(!options.boundingBoxesOnly());
+    options.setBoundingBoxesOnly(true);
+    TEST(options.boundingBoxesOnly());
+
+    nkar::Image empty(imagePath + "/empty.png");
+    std::vector<uint8_t> dots(empty.scanline(0),
+                              empty.scanline(0) + empty.width() * empty.height() * 3);
+    dots[(10 * empty.width() + 13) * 3] ^= 0xFF;
+    dots[(40 * empty.width() + 5) * 3] ^= 0xFF;
+    const nkar::ImageView view(dots.data(), empty.width(), empty.height(), empty.width() * 3);
+
+    // The boxes enclose the outlines of the blocks.
+    options.setBlockSize(4, 2);
+    auto result = nkar::Comparator::compare(empty.view(), view, options);
+    TEST(result.status() == nkar::Result::Status::Different);
+    TEST(result.boundingBoxes().size() == 2);
+    TEST(result.boundingBoxes()[0] == nkar::Rect(12, 8, 5, 5));
+    TEST(result.boundingBoxes()[1] == nkar::Rect(4, 38, 5, 5));
+    TEST(result.contourCount() == 0 && result.contours().isEmpty());
+    TEST(result.resultImage().isNull() && result.differenceMask().isNull());
+
+    const nkar::Rect &box = result.boundingBoxes()[0];
+    TEST(box.right() == 16 && box.bottom() == 12 && !box.isEmpty());
+    TEST(box.contains(nkar::Point(13, 10)) && !box.contains(nkar::Point(17, 10)));
+    TEST(nkar::Rect().isEmpty());
+
+    options.setMaxContours(1);
+    result = nkar::Comparator::compare(empty.view(), view, options);
+    TEST(result.isTruncated() && result.boundingBoxes().size() == 1);
+    options.setMaxContours(0);
+
+    TEST(nkar::Comparator::compare(empty, empty, options).status() ==
+         nkar::Result::Status::Identical);
+
+    // The boxes enclose all different pixels and don't depend on the number of threads.
+    nkar::Image map1(imagePath + "/map1.png");
+    nkar::Image map2(imagePath + "/map2.png");
+    options.setBlockSize(1, 1);
+    const auto boxes = nkar::Comparator::compare(map1, map2, options).boundingBoxes();
+    TEST(boxes.size() == 2);
+    size_t outside = 0;
+    nkar::Comparator::compare(map1, map2).differenceMask().forEachSetBit([&](int x, int y) {
+      outside += std::none_of(boxes.begin(), boxes.end(), [x, y](const nkar::Rect &rect) {
+        return rect.contains(nkar::Point(x, y));
+      });
+    });
+    TEST(outside == 0);
+
+    for (int threads : { 2, 3, 7 }) {
+      options.setThreadCount(threads);
+      TEST(nkar::Comparator::compare(map1, map2, options).boundingBoxes() == boxes);
+    }
+
+    // Only the tiles with different hashes are compared.
+    map1.buildTileIndex();
+    map2.buildTileIndex();
+    TEST(nkar::Comparator::compare(map1, map2, options).boundingBoxes() == boxes);
+
+    options.setMaxDifferentPixels(100);
+    result = nkar::Comparator::compare(map1, map2, options);
+    TEST(result.isTruncated() && result.boundingBoxes().empty());
+  }
+
+  // Component statistics
+  {
+    nkar::Image empty(imagePath + "/empty.png");
+    std::vector<uint8_t> pixels(empty.scanline(0),
+                                empty.scanline(0) + empty.width() * empty.height() * 3);
+    auto setPixel = [&](int row, int column, uint8_t red, uint8_t green, uint8_t blue) {
+      uint8_t *pixel = &pixels[(row * empty.width() + column) * 3];
+      pixel[0] = red;
+      pixel[1] = green;
+      pixel[2] = blue;
+    };
+    setPixel(10, 13, 0, 255, 215);
+    setPixel(12, 15, 255, 155, 255);
+    setPixel(40, 5, 250, 250, 250);
+    const nkar::Image changed(
+      nkar::ImageView(pixels.data(), empty.width(), empty.height(), empty.width() * 3));
+
+    nkar::Options options;
+    options.setBlockSize(4, 2);
+    auto result = nkar::Comparator::compare(empty, changed, options);
+    const nkar::Components components = result.components();
+    TEST(components.size() == 2 && !components.isEmpty());
+    TEST(components.pixelCounts()[0] == 2 && components.pixelCounts()[1] == 1);
+    TEST(components.boundingBoxes()[0] == nkar::Rect(13, 10, 3, 3));
+    TEST(components.boundingBoxes()[1] == nkar::Rect(5, 40, 1, 1));
+    TEST(components.centroidsX()[0] == 14 && components.centroidsY()[0] == 11);
+    TEST(components.maxDeltas(nkar::Components::Channel::Red)[0] == 255);
+    TEST(components.maxDeltas(nkar::Components::Channel::Green)[0] == 100);
+    TEST(components.meanDeltas(nkar::Components::Channel::Blue)[0] == 20);
+    TEST(components.meanDeltas(nkar::Components::Channel::Green)[1] == 5);
+
+    // The i-th component is enclosed by the i-th outer polygon.
+    const nkar::Contours &polygons = result.contours();
+    for (size_t i = 0, component = 0; i < polygons.size(); ++i) {
+      if (!polygons.isHole(i)) {
+        TEST(polygons.area(i) >= components.pixelCounts()[component++]);
+      }
+    }
+
+    // The statistics cover the components beyond the contour limit.
+    options.setMaxContours(1);
+    result = nkar::Comparator::compare(empty, changed, options);
+    TEST(result.isTruncated() && result.components().size() == 2);
+
+    // The bounding box mode gathers the same statistics.
+    options.setBoundingBoxesOnly(true);
+    TEST(nkar::Comparator::compare(empty, changed, options).components().pixelCounts() ==
+         components.pixelCounts());
+
+    // All different pixels belong to the components regardless of the number of threads.
+    nkar::Image map1(imagePath + "/map1.png");
+    nkar::Image map2(imagePath + "/map2.png");
+    options = nkar::Options();
+    result = nkar::Comparator::compare(map1, map2, options);
+    const auto &counts = result.components().pixelCounts();
+    TEST(std::accumulate(counts.begin(), counts.end(), size_t(0)) ==
+         result.differenceMask().count());
+    for (int threads : { 2, 7 }) {
+      options.setThreadCount(threads);
+      TEST(nkar::Comparator::compare(map1, map2, options).components().pixelCounts() == counts);
+    }
+
+    TEST(nkar::Comparator::compare(empty, empty).components().isEmpty());
+  }
+
+  // Dropping small components
+  {
+    nkar::Options options;
+    TEST(options.minComponentArea() == 0);
+    options.setMinComponentArea(2);
+    TEST(options.minComponentArea() == 2);
+
+    nkar::Image empty(imagePath + "/empty.png");
+    std::vector<uint8_t> pixels(empty.scanline(0),
+                                empty.scanline(0) + empty.width() * empty.height() * 3);
+    auto change = [&](int row, int column) {
+      pixels[(row * empty.width() + column) * 3] ^= 0xFF;
+    };
+    change(10, 10);
+    change(10, 11);
+    change(50, 60);
+    change(90, 20);
+    const nkar::ImageView view(pixels.data(), empty.width(), empty.height(), empty.width() * 3);
+
+    // Only the pair of pixels is outlined.
+    auto result = nkar::Comparator::compare(empty.view(), view, options);
+    TEST(result.status() == nkar::Result::Status::Different);
+    TEST(result.contourCount() == 1 && result.contours().size() == 1);
+    TEST(result.components().size() == 1 && result.components().pixelCounts()[0] == 2);
+    TEST(sameColor(result.resultImage().pixel(10, 9), options.highlightColor()));
+    TEST(sameColor(result.resultImage().pixel(50, 59), empty.pixel(50, 59)));
+    TEST(result.differenceMask().count() == 4);
+
+    options.setBoundingBoxesOnly(true);
+    result = nkar::Comparator::compare(empty.view(), view, options);
+    TEST(result.boundingBoxes().size() == 1 && result.components().size() == 1);
+    options.setBoundingBoxesOnly(false);
+
+    // The images are identical, if all components are dropped.
+    options.setMinComponentArea(3);
+    result = nkar::Comparator::compare(empty.view(), view, options);
+    TEST(result.status() == nkar::Result::Status::Identical);
+    TEST(result.contourCount() == 0 && result.resultImage().isNull());
+
+    // The merged differences are counted together.
+    options.setMergeRadius(50);
+    TEST(nkar::Comparator::compare(empty.view(), view, options).components().size() == 1);
+  }
+
   // Large
   TEST(test(imagePath + "/empty_large.png", imagePath + "/large.png", tmpImg,
             imagePath + "/large_result.png"));
@@ -154,6 +962,161 @@ int main(int argc, char **argv)
 
   image.drawLine({}, {}, {});
   TEST(image.save("foo") == false);
+  TEST(image.scanline(0) == nullptr);
+
+  nkar::Image lenna(imagePath + "/lenna.png");
+  const unsigned char *scanline = lenna.scanline(10);
+  TEST(scanline != nullptr);
+  TEST(scanline[3 * 20]     == lenna.pixel(10, 20).red());
+  TEST(scanline[3 * 20 + 1] == lenna.pixel(10, 20).green());
+  TEST(scanline[3 * 20 + 2] == lenna.pixel(10, 20).blue());
+
+  // Moving an image takes over its pixel data.
+  nkar::Image moved(std::move(lenna));
+  TEST(moved.scanline(10) == scanline && lenna.isNull());
+  TEST(lenna.width() == 0 && lenna.height() == 0);
+  lenna = std::move(moved);
+  TEST(lenna.scanline(10) == scanline && moved.isNull());
+
+  // Containers move images and results on reallocation instead of copying them.
+  static_assert(std::is_nothrow_move_constructible<nkar::Image>::value &&
+                std::is_nothrow_move_assignable<nkar::Image>::value, "Image move throws");
+  static_assert(std::is_nothrow_move_constructible<nkar::Result>::value &&
+                std::is_nothrow_move_assignable<nkar::Result>::value, "Result move throws");
+  {
+    // Copies of the image would copy the modified band.
+    std::vector<nkar::Image> images(1, lenna);
+    images[0].drawLine({ 0, 10 }, { 5, 10 }, { 1, 2, 3 });
+    const unsigned char *data = images[0].scanline(10);
+    TEST(data != lenna.scanline(10));
+    images.resize(images.capacity() + 1);
+    TEST(images[0].scanline(10) == data);
+  }
+
+  // The moved-from image is the same as the default constructed one.
+  nkar::Image rgbx(imagePath + "/lenna.png", nkar::PixelFormat::RGBX);
+  nkar::Image target(std::move(rgbx));
+  TEST(rgbx.isNull() && rgbx.format() == nkar::Image().format() && rgbx.stride() == 0);
+  TEST(target.format() == nkar::PixelFormat::RGBX);
+
+  // Copies share the pixel data until the modified bands of rows are copied.
+  nkar::Image copy(lenna);
+  TEST(copy.scanline(10) == scanline);
+  const nkar::Color original = lenna.pixel(10, 20);
+  copy.drawLine({ 20, 10 }, { 20, 10 }, { 1, 2, 3 });
+  TEST(sameColor(copy.pixel(10, 20), { 1, 2, 3 }) && sameColor(lenna.pixel(10, 20), original));
+  TEST(copy.scanline(10) != scanline && copy.scanline(100) == lenna.scanline(100));
+  TEST(sameColor(copy.pixel(10, 21), lenna.pixel(10, 21)));
+
+  // The whole pixel data is made contiguous once needed.
+  const nkar::ImageView copyView = copy.view();
+  TEST(copyView.scanline(100) != lenna.scanline(100));
+  TEST(sameColor(copyView.pixel(10, 20), { 1, 2, 3 }) &&
+       sameColor(copyView.pixel(100, 20), lenna.pixel(100, 20)));
+  copy = nkar::Image(copyView);
+  TEST(sameColor(copy.pixel(10, 20), { 1, 2, 3 }));
+
+  // Taking the result image doesn't copy it.
+  {
+    auto result = nkar::Comparator::compare(imagePath + "/map1.png", imagePath + "/map2.png");
+    const unsigned char *data = result.resultImage().scanline(0);
+    nkar::Result other(std::move(result));
+    TEST(other.resultImage().scanline(0) == data && other.contourCount() > 0);
+    nkar::Image taken = other.takeResultImage();
+    TEST(taken.scanline(0) == data && other.resultImage().isNull());
+    TEST(other.status() == nkar::Result::Status::Different);
+
+    other.setResultImage(std::move(taken));
+    TEST(other.resultImage().scanline(0) == data && taken.isNull());
+  }
+
+  // The result image shares the rows without outlines with the compared image.
+  {
+    nkar::Image empty(imagePath + "/empty.png");
+    nkar::Image changed(imagePath + "/1.png");
+    auto output = nkar::Comparator::compare(empty, changed).takeResultImage();
+    int shared = 0;
+    for (int row = 0; row < changed.height(); ++row) {
+      shared += output.scanline(row) == changed.scanline(row);
+    }
+    TEST(shared > 0 && shared < changed.height());
+
+    // The result image stays valid after the compared one is destroyed.
+    changed = nkar::Image();
+    TEST(output.save(tmpImg));
+    TEST(nkar::Comparator::isIdentical(tmpImg, imagePath + "/1_result.png"));
+    std::remove(tmpImg.c_str());
+  }
+
+  // A const image with modified bands can be viewed from several threads.
+  {
+    const nkar::Image changed(imagePath + "/1.png");
+    const nkar::Image output =
+      nkar::Comparator::compare(nkar::Image(imagePath + "/empty.png"), changed).takeResultImage();
+    const unsigned char *row = output.scanline(0);
+    std::vector<const unsigned char *> data(4);
+    std::vector<std::thread> threads;
+    for (size_t i = 0; i < data.size(); ++i) {
+      threads.emplace_back([&, i]() {
+        data[i] = output.view().scanline(0);
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    TEST(std::count(data.begin(), data.end(), data[0]) == (int)data.size());
+    TEST(output.scanline(0) == row && data[0] != changed.scanline(0));
+    TEST(nkar::Comparator::isIdentical(output, nkar::Image(imagePath + "/1_result.png")));
+
+    // The copies of the image share the contiguous data.
+    nkar::Image copy(output);
+    TEST(copy.scanline(0) == data[0] && copy.view().scanline(0) == data[0]);
+  }
+
+  // Images with 4 bytes per pixel
+  {
+    nkar::Image rgb(imagePath + "/lenna.png");
+    TEST(rgb.format() == nkar::PixelFormat::RGB && rgb.stride() == rgb.width() * 3);
+
+    nkar::Options options;
+    options.setHighlightColor({ 51, 255, 51 });
+    const auto expected =
+      nkar::Comparator::compare(rgb, nkar::Image(imagePath + "/lenna_changed.png"), options);
+    for (auto format : { nkar::PixelFormat::RGBA, nkar::PixelFormat::RGBX,
+                         nkar::PixelFormat::BGRX }) {
+      nkar::Image image(imagePath + "/lenna.png", format);
+      TEST(image.format() == (format == nkar::PixelFormat::RGBA ? nkar::PixelFormat::RGBA
+                                                                : nkar::PixelFormat::RGBX));
+      TEST(image.stride() % 64 == 0 && image.stride() >= image.width() * 4);
+      TEST(reinterpret_cast<uintptr_t>(image.scanline(1)) % 64 == 0);
+      TEST(sameColor(image.pixel(10, 20), rgb.pixel(10, 20)));
+      TEST(nkar::Comparator::isIdentical(image, rgb));
+
+      // The result image keeps the format and is saved as the RGB one.
+      const auto result = nkar::Comparator::compare(
+        image, nkar::Image(imagePath + "/lenna_changed.png", format), options);
+      TEST(result.contourCount() == expected.contourCount());
+      TEST(result.resultImage().format() == image.format());
+      TEST(result.resultImage().save(tmpImg));
+      TEST(nkar::Comparator::isIdentical(tmpImg, imagePath + "/lenna_result.png"));
+      std::remove(tmpImg.c_str());
+
+      TEST(nkar::Image(rgb.view(), format).scanline(5)[4 * 7 + 1] == rgb.scanline(5)[3 * 7 + 1]);
+    }
+
+    // The alpha channel is kept in the RGBA format only.
+    const uint8_t pixels1[] = { 1, 2, 3, 255, 4, 5, 6, 255 };
+    const uint8_t pixels2[] = { 1, 2, 3, 255, 4, 5, 6, 0 };
+    const nkar::ImageView view1(pixels1, 2, 1, 8, nkar::PixelFormat::RGBA);
+    const nkar::ImageView view2(pixels2, 2, 1, 8, nkar::PixelFormat::RGBA);
+    const nkar::Image rgba(view2, nkar::PixelFormat::RGBA);
+    TEST(rgba.scanline(0)[7] == 0 && rgba.scanline(0)[3] == 255);
+    TEST(!nkar::Comparator::isIdentical(nkar::Image(view1, nkar::PixelFormat::RGBA), rgba));
+    TEST(nkar::Comparator::isIdentical(nkar::Image(view1, nkar::PixelFormat::RGBX),
+                                       nkar::Image(view2, nkar::PixelFormat::RGBX)));
+    TEST(nkar::Image(view2).scanline(0)[3] == 4);
+    TEST(nkar::Image(view2, nkar::PixelFormat::BGRA).scanline(0)[7] == 0);
+  }
 
   return Status::Ok;
 }